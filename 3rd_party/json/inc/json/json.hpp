@@ -279,6 +279,23 @@ namespace json
 	value from_string(const std::string&);
 	value from_string(const char* data, size_t length);
 
+	// Builds a value from a document received in pieces, so that the
+	// document never needs to be kept in one buffer.
+	class stream_parser {
+	public:
+		stream_parser();
+		~stream_parser();
+		stream_parser(const stream_parser&) = delete;
+		stream_parser& operator=(const stream_parser&) = delete;
+
+		bool feed(const char* data, size_t length);
+		value finish();
+		bool failed() const;
+	private:
+		struct state;
+		std::unique_ptr<state> m_state;
+	};
+
 	struct vector : value {
 		using container_t = std::vector<value>;
 		using iterator = container_t::iterator;
@@ -538,4 +538,320 @@ namespace json
 
 		return ret;
 	}
+
+	struct stream_parser::state {
+		enum class lexer {
+			idle,
+			string,
+			escape,
+			unicode,
+			number,
+			keyword
+		};
+
+		enum class expect {
+			first,
+			item,
+			key,
+			colon,
+			next
+		};
+
+		struct frame {
+			value node;
+			bool is_map;
+			expect next;
+			std::string key;
+		};
+
+		parser::pos_t pos;
+		parser::pos_t token_pos;
+		lexer mode = lexer::idle;
+		std::string text;
+		uint16_t unicode = 0;
+		int hex_digits = 0;
+		bool integer = true;
+		parser::token keyword = parser::JSON_NULL;
+		const char* keyword_rest = nullptr;
+
+		std::vector<frame> stack;
+		value root;
+		bool done = false;
+		bool error = false;
+
+		bool fail(const parser::pos_t& at, const char* msg)
+		{
+			at.err(msg);
+			error = true;
+			return false;
+		}
+
+		bool emit(value v)
+		{
+			if (stack.empty()) {
+				if (!done) {
+					root = std::move(v);
+					done = true;
+				}
+				return true;
+			}
+
+			auto& top = stack.back();
+			if (top.is_map) {
+				if (top.next == expect::first || top.next == expect::key) {
+					if (!v.is<STRING>())
+						return fail(token_pos, "Expecting ':'");
+					top.key = v.as_string();
+					top.next = expect::colon;
+					return true;
+				}
+				if (top.next != expect::item)
+					return fail(token_pos, "Expecting ','");
+				map{ top.node }.add(top.key, v);
+			} else {
+				if (top.next != expect::first && top.next != expect::item)
+					return fail(token_pos, "Expecting ','");
+				vector{ top.node }.add(v);
+			}
+			top.next = expect::next;
+			return true;
+		}
+
+		bool expects_value() const
+		{
+			if (stack.empty())
+				return !done;
+			auto& top = stack.back();
+			if (top.is_map)
+				return top.next == expect::item;
+			return top.next == expect::first || top.next == expect::item;
+		}
+
+		bool open(bool is_map)
+		{
+			if (!expects_value())
+				return done && stack.empty() ? true : fail(token_pos, "Unexpected token");
+			stack.push_back({ is_map ? (value)map{} : (value)vector{}, is_map, expect::first, {} });
+			return true;
+		}
+
+		bool close(bool is_map)
+		{
+			if (stack.empty() || stack.back().is_map != is_map)
+				return done ? true : fail(token_pos, "Unexpected token");
+			auto& top = stack.back();
+			if (top.next != expect::first && top.next != expect::next)
+				return fail(token_pos, "Unexpected token");
+			auto node = std::move(top.node);
+			stack.pop_back();
+			return emit(std::move(node));
+		}
+
+		bool punct(char c)
+		{
+			if (stack.empty())
+				return done ? true : fail(token_pos, "Unexpected token");
+			auto& top = stack.back();
+			if (c == ',') {
+				if (top.next != expect::next)
+					return fail(token_pos, "Unexpected token");
+				top.next = top.is_map ? expect::key : expect::item;
+				return true;
+			}
+			if (!top.is_map || top.next != expect::colon)
+				return fail(token_pos, "Expecting ':'");
+			top.next = expect::item;
+			return true;
+		}
+
+		bool number()
+		{
+			mode = lexer::idle;
+			try {
+				if (integer)
+					return emit((std::int64_t)std::stoll(text));
+				return emit(std::stod(text));
+			} catch (const std::exception&) {
+				return fail(token_pos, "Invalid number");
+			}
+		}
+
+		bool word()
+		{
+			mode = lexer::idle;
+			switch (keyword) {
+			case parser::JSON_TRUE: return emit(true);
+			case parser::JSON_FALSE: return emit(false);
+			default: return emit({});
+			}
+		}
+
+		bool start(char c)
+		{
+			token_pos = pos;
+			switch (c) {
+			case '[': return open(false);
+			case '{': return open(true);
+			case ']': return close(false);
+			case '}': return close(true);
+			case ':':
+			case ',': return punct(c);
+			case 'n': keyword = parser::JSON_NULL; keyword_rest = "ull"; mode = lexer::keyword; return true;
+			case 't': keyword = parser::JSON_TRUE; keyword_rest = "rue"; mode = lexer::keyword; return true;
+			case 'f': keyword = parser::JSON_FALSE; keyword_rest = "alse"; mode = lexer::keyword; return true;
+			case '"': text.clear(); mode = lexer::string; return true;
+			case '-':
+			case '0': case '1': case '2': case '3': case '4':
+			case '5': case '6': case '7': case '8': case '9':
+				text.assign(1, c);
+				integer = true;
+				mode = lexer::number;
+				return true;
+			default:
+				if (std::isspace((uint8_t)c))
+					return true;
+				return fail(pos, "Unknown character");
+			}
+		}
+
+		bool hex(char c)
+		{
+			unicode <<= 4;
+			switch (c) {
+			case '0': case '1': case '2': case '3': case '4':
+			case '5': case '6': case '7': case '8': case '9':
+				unicode += c - '0';
+				break;
+			case 'a': case 'b': case 'c': case 'd': case 'e': case 'f':
+				unicode += c - 'a' + 10;
+				break;
+			case 'A': case 'B': case 'C': case 'D': case 'E': case 'F':
+				unicode += c - 'A' + 10;
+				break;
+			default:
+				return fail(pos, "Expecting HEX");
+			};
+
+			if (++hex_digits == 4) {
+				std::u16string codepoint{ unicode, 0 };
+				text += utf::narrowed(codepoint);
+				mode = lexer::string;
+			}
+			return true;
+		}
+
+		bool escape(char c)
+		{
+			mode = lexer::string;
+			switch (c) {
+			case '"': text.push_back('\"'); break;
+			case '\\': text.push_back('\\'); break;
+			case '/': text.push_back('/'); break;
+			case 'b': text.push_back('\b'); break;
+			case 'f': text.push_back('\f'); break;
+			case 'n': text.push_back('\n'); break;
+			case 'r': text.push_back('\r'); break;
+			case 't': text.push_back('\t'); break;
+			case 'u':
+				unicode = 0;
+				hex_digits = 0;
+				mode = lexer::unicode;
+				break;
+			default:
+				text.push_back('\\');
+				text.push_back((uint8_t)c);
+			}
+			return true;
+		}
+
+		bool feed(char c)
+		{
+			switch (mode) {
+			case lexer::idle:
+				return start(c);
+			case lexer::string:
+				if (c == '\\')
+					mode = lexer::escape;
+				else if (c == '"') {
+					mode = lexer::idle;
+					return emit(text);
+				} else
+					text.push_back(c);
+				return true;
+			case lexer::escape:
+				return escape(c);
+			case lexer::unicode:
+				return hex(c);
+			case lexer::number:
+				switch (c) {
+				case '0': case '1': case '2': case '3': case '4':
+				case '5': case '6': case '7': case '8': case '9':
+				case '+': case '-':
+					text.push_back(c);
+					return true;
+				case '.': case 'e': case 'E':
+					integer = false;
+					text.push_back(c);
+					return true;
+				}
+				return number() && start(c);
+			case lexer::keyword:
+				if (*keyword_rest != c)
+					return fail(pos, "Invalid token");
+				if (!*++keyword_rest)
+					return word();
+				return true;
+			}
+			return true;
+		}
+	};
+
+	stream_parser::stream_parser()
+		: m_state{ std::make_unique<state>() }
+	{
+	}
+
+	stream_parser::~stream_parser() = default;
+
+	bool stream_parser::feed(const char* data, size_t length)
+	{
+		auto& st = *m_state;
+		if (st.error)
+			return false;
+
+		for (auto end = data + length; data != end; ++data) {
+			if (!st.feed(*data))
+				return false;
+
+			if (*data == '\n') st.pos.enter();
+			else st.pos.next();
+		}
+		return true;
+	}
+
+	value stream_parser::finish()
+	{
+		auto& st = *m_state;
+		if (!st.error) {
+			switch (st.mode) {
+			case state::lexer::number:
+				st.number();
+				break;
+			case state::lexer::idle:
+				break;
+			default:
+				st.fail(st.pos, "Unexpected end of document");
+			}
+		}
+
+		if (st.error || !st.done)
+			return {};
+
+		return std::move(st.root);
+	}
+
+	bool stream_parser::failed() const
+	{
+		return m_state->error;
+	}
 };
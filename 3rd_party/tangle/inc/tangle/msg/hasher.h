@@ -41,6 +41,15 @@ namespace tangle { namespace msg {
 			return hash(s.data(), s.length());
 		}
 		static size_t hash(const char*, size_t);
+
+		// Hash of the ASCII-lowercased string, for keys compared
+		// case-insensitively.
+		hasher& append_icase(const void* buffer, size_t length);
+		static size_t hash_icase(const cstring& s)
+		{
+			return hash_icase(s.data(), s.length());
+		}
+		static size_t hash_icase(const char*, size_t);
 	private:
 		size_t m_value;
 	};
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define TANGLE_SCAN_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TANGLE_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(TANGLE_SCAN_AVX2) || defined(TANGLE_SCAN_SSE2))
+#include <intrin.h>
+#endif
+
+namespace tangle { namespace msg { namespace scan {
+	namespace impl {
+		inline unsigned first_bit(uint32_t mask)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return index;
+#else
+			return __builtin_ctz(mask);
+#endif
+		}
+	}
+
+	// Returns the first occurence of c in [cur, end), or end. Header
+	// blocks are scanned a vector register at a time, where available.
+	inline const char* find(const char* cur, const char* end, char c)
+	{
+#if defined(TANGLE_SCAN_AVX2)
+		auto needle = _mm256_set1_epi8(c);
+		while (end - cur >= 32) {
+			auto chunk = _mm256_loadu_si256((const __m256i*)cur);
+			auto mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+			if (mask)
+				return cur + impl::first_bit(mask);
+			cur += 32;
+		}
+#elif defined(TANGLE_SCAN_SSE2)
+		auto needle = _mm_set1_epi8(c);
+		while (end - cur >= 16) {
+			auto chunk = _mm_loadu_si128((const __m128i*)cur);
+			auto mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+			if (mask)
+				return cur + impl::first_bit(mask);
+			cur += 16;
+		}
+#endif
+		if (cur == end)
+			return end;
+		auto found = std::memchr(cur, (unsigned char)c, end - cur);
+		return found ? static_cast<const char*>(found) : end;
+	}
+}}};
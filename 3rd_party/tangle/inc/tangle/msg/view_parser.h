@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2016 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+#include <vector>
+#include <tuple>
+#include <tangle/msg/http_parser.h>
+
+namespace tangle { namespace msg {
+	class field_view {
+	public:
+		field_view() = default;
+		field_view(cstring key, cstring value, bool folded)
+			: m_key(key)
+			, m_value(value)
+			, m_hash(hasher::hash_icase(key))
+			, m_folded(folded)
+		{
+		}
+
+		cstring key() const { return m_key; }
+		size_t hash() const { return m_hash; }
+		bool folded() const { return m_folded; }
+
+		// Raw value, with surrounding whitespace removed. For folded
+		// fields, it still contains the line breaks.
+		cstring value() const { return m_value; }
+
+		// Value with continuation lines unfolded; allocates only here.
+		std::string str() const;
+
+		void extend(const char* end)
+		{
+			m_value = { m_value.data(), size_t(end - m_value.data()) };
+			m_folded = true;
+		}
+
+		void trim();
+	private:
+		cstring m_key;
+		cstring m_value;
+		size_t m_hash = 0;
+		bool m_folded = false;
+	};
+
+	// Header fields pointing into the parsed buffer. Keys are matched
+	// case-insensitively; the buffer must outlive the dictionary.
+	class dict_view {
+	public:
+		using const_iterator = std::vector<field_view>::const_iterator;
+
+		const field_view* find(cstring key) const;
+		bool empty() const { return m_fields.empty(); }
+		size_t size() const { return m_fields.size(); }
+		const_iterator begin() const { return m_fields.begin(); }
+		const_iterator end() const { return m_fields.end(); }
+
+		void clear() { m_fields.clear(); }
+		void add(cstring key, cstring value) { m_fields.emplace_back(key, value, false); }
+		field_view& back() { return m_fields.back(); }
+		void trim()
+		{
+			for (auto& field : m_fields)
+				field.trim();
+		}
+	private:
+		std::vector<field_view> m_fields;
+	};
+
+	class view_parser {
+	public:
+		// Parses the fields in place. Every call must pass the same buffer,
+		// which may only grow between calls. On separator, the position of
+		// the empty line is returned.
+		std::pair<size_t, parsing> parse(const char* data, size_t length);
+
+		// Treats the end of a buffer, which will not grow anymore, as the
+		// empty line closing the fields.
+		parsing finish(size_t length);
+
+		const dict_view& dict() const { return m_dict; }
+		void reset();
+	private:
+		dict_view m_dict;
+		size_t m_last_line_end = 0;
+	};
+
+	class http_response_view {
+	public:
+		std::pair<size_t, parsing> parse(const char* data, size_t length);
+		parsing finish(size_t length);
+
+		const http_version& proto() const { return m_proto; }
+		int status() const { return m_status; }
+		cstring reason() const { return m_reason; }
+		const dict_view& dict() const { return m_fields.dict(); }
+	private:
+		view_parser m_fields;
+		http_version m_proto;
+		int m_status = 0;
+		cstring m_reason;
+		size_t m_offset = 0;
+	};
+}};
@@ -23,32 +23,12 @@
  */
 
 #include <tangle/msg/base_parser.h>
+#include <tangle/msg/scan.h>
 #include <algorithm>
 #include <cctype>
 
 namespace tangle { namespace msg {
 	namespace {
-		template <typename V>
-		auto find(V& contents, const char* sub)
-		{
-			auto cur = std::begin(contents);
-			auto end = std::end(contents);
-
-			if (!sub || !*sub)
-				return end;
-
-			auto len = strlen(sub);
-			do {
-				cur = std::find(cur, end, *sub);
-				if (cur == end) break;
-				if (size_t(end - cur) < len) break;
-				if (!memcmp(&*cur, sub, len))
-					return cur;
-				++cur;
-			} while (true);
-			return end;
-		}
-
 		inline size_t report_read(size_t prev, size_t position)
 		{
 			return (position > prev) ? position - prev : 0;
@@ -70,12 +50,12 @@ namespace tangle { namespace msg {
 		auto prev = m_contents.size();
 		m_contents.insert(m_contents.end(), data, data + length);
 
-		auto begin = std::begin(m_contents);
-		auto cur = std::next(begin, m_last_line_end);
-		auto end = std::end(m_contents);
+		const char* begin = m_contents.data();
+		auto cur = begin + m_last_line_end;
+		auto end = begin + m_contents.size();
 
 		while (cur != end) {
-			auto it = std::find(cur, end, '\r');
+			auto it = scan::find(cur, end, '\r');
 			if (it == end) break;
 			if (std::next(it) == end) break;
 			if (*std::next(it) != '\n') // mid-line \r? - check with RFC if ignore, or error
@@ -96,7 +76,7 @@ namespace tangle { namespace msg {
 				auto& fld = std::get<1>(m_field_list.back());
 				fld = span(fld.offset(), m_last_line_end - fld.offset());
 			} else {
-				auto colon = std::find(cur, it, ':');
+				auto colon = scan::find(cur, it, ':');
 				if (colon == it) // no colon in field's first line
 					return { report_read(prev, std::distance(begin, it)), parsing::error };
 
@@ -62,4 +62,23 @@ namespace tangle { namespace msg {
 	{
 		return hasher { }.append(s, l).value();
 	}
+
+	hasher& hasher::append_icase(const void* buffer, size_t length)
+	{
+		constexpr auto prime = consts::fnv_const<sizeof(size_t)>::prime;
+
+		for (auto data = (const char*)buffer; length; ++data, --length) {
+			auto c = *data;
+			if (c >= 'A' && c <= 'Z')
+				c += 'a' - 'A';
+			m_value ^= (size_t)c;
+			m_value *= prime;
+		}
+		return *this;
+	}
+
+	size_t hasher::hash_icase(const char* s, size_t l)
+	{
+		return hasher { }.append_icase(s, l).value();
+	}
 }};
@@ -23,6 +23,8 @@
  */
 
 #include <tangle/msg/http_parser.h>
+#include <tangle/msg/view_parser.h>
+#include <tangle/msg/scan.h>
 #include <algorithm>
 
 namespace tangle { namespace msg {
@@ -75,7 +77,7 @@ namespace tangle { namespace msg {
 		size_t len = 1;
 
 		if (m_resource.empty() || m_resource.back() != '\r') {
-			auto it = std::find(cur, end, '\r');
+			auto it = scan::find(cur, end, '\r');
 			if (it == end || it == (end - 1)) {
 				m_resource.append(data, length);
 				return { length, parsing::reading };
@@ -129,7 +131,7 @@ namespace tangle { namespace msg {
 		size_t len = 1;
 
 		if (m_reason.empty() || m_reason.back() != '\r') {
-			auto it = std::find(cur, end, '\r');
+			auto it = scan::find(cur, end, '\r');
 			if (it == end || it == (end - 1)) {
 				m_reason.append(data, length);
 				return { length, parsing::reading };
@@ -166,7 +168,8 @@ namespace tangle { namespace msg {
 			while (cur != end && *cur == ' ')
 				++cur;
 			auto msg = parse_number(cur, end, m_status);
-			if (msg == cur || msg == end || *msg != ' ' || m_status < 100)
+			// the reason phrase may be empty, even without its separator
+			if (msg == cur || (msg != end && *msg != ' ') || m_status < 100)
 				return { len, parsing::error };
 
 			while (msg != end && *msg == ' ')
@@ -176,4 +179,46 @@ namespace tangle { namespace msg {
 
 		return { len, parsing::separator };
 	}
+
+	std::pair<size_t, parsing> http_response_view::parse(const char* data, size_t length)
+	{
+		if (!m_offset) {
+			// HTTP-Version SP Status-Code SP Reason-Phrase CRLF
+			auto end = data + length;
+			auto it = scan::find(data, end, '\r');
+			if (it == end || it == (end - 1))
+				return { length, parsing::reading };
+			if (it[1] != '\n')
+				return { (it - data), parsing::error };
+
+			auto line_end = it;
+			auto status_pos = std::find(data, line_end, ' ');
+			if (status_pos == line_end || !parse_proto(data, status_pos, m_proto))
+				return { (it - data), parsing::error };
+
+			auto cur = status_pos;
+			while (cur != line_end && *cur == ' ')
+				++cur;
+			auto msg = parse_number(cur, line_end, m_status);
+			// the reason phrase may be empty, even without its separator
+			if (msg == cur || (msg != line_end && *msg != ' ') || m_status < 100)
+				return { (it - data), parsing::error };
+
+			while (msg != line_end && *msg == ' ')
+				++msg;
+			m_reason = { msg, size_t(line_end - msg) };
+			m_offset = it - data + 2;
+		}
+
+		auto ret = m_fields.parse(data + m_offset, length - m_offset);
+		std::get<size_t>(ret) += m_offset;
+		return ret;
+	}
+
+	parsing http_response_view::finish(size_t length)
+	{
+		if (!m_offset || length < m_offset)
+			return parsing::error;
+		return m_fields.finish(length - m_offset);
+	}
 }}
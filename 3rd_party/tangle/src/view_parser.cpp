@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2016 midnightBITS
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <tangle/msg/view_parser.h>
+#include <tangle/msg/scan.h>
+#include <algorithm>
+#include <cctype>
+
+namespace tangle { namespace msg {
+	std::string produce(cstring cs);
+
+	namespace {
+		inline bool is_space(char c)
+		{
+			return !!std::isspace((uint8_t)c);
+		}
+
+		inline char lower(char c)
+		{
+			return (c >= 'A' && c <= 'Z') ? c + 'a' - 'A' : c;
+		}
+
+		bool equal_icase(cstring lhs, cstring rhs)
+		{
+			if (lhs.length() != rhs.length())
+				return false;
+
+			auto it = rhs.begin();
+			for (auto c : lhs) {
+				if (lower(c) != lower(*it++))
+					return false;
+			}
+			return true;
+		}
+
+		cstring trimmed(const char* ptr, const char* end)
+		{
+			while (ptr != end && is_space(*ptr))
+				++ptr;
+			while (ptr != end && is_space(end[-1]))
+				--end;
+			return { ptr, size_t(end - ptr) };
+		}
+	}
+
+	std::string field_view::str() const
+	{
+		if (m_folded)
+			return produce(m_value);
+		return m_value.str();
+	}
+
+	void field_view::trim()
+	{
+		m_value = trimmed(m_value.begin(), m_value.end());
+	}
+
+	const field_view* dict_view::find(cstring key) const
+	{
+		auto hash = hasher::hash_icase(key);
+		for (auto& field : m_fields) {
+			if (field.hash() == hash && equal_icase(field.key(), key))
+				return &field;
+		}
+		return nullptr;
+	}
+
+	std::pair<size_t, parsing> view_parser::parse(const char* data, size_t length)
+	{
+		auto cur = data + m_last_line_end;
+		auto end = data + length;
+
+		while (cur != end) {
+			auto it = scan::find(cur, end, '\r');
+			if (it == end) break;
+			if (std::next(it) == end) break;
+			if (it[1] != '\n')
+				return { size_t(it - data), parsing::error };
+
+			if (it == cur) { // empty line
+				m_dict.trim();
+				return { size_t(it - data), parsing::separator };
+			}
+
+			if (is_space(*cur)) {
+				if (m_dict.empty())
+					return { size_t(it - data), parsing::error };
+				m_dict.back().extend(it);
+			} else {
+				auto colon = scan::find(cur, it, ':');
+				if (colon == it) // no colon in field's first line
+					return { size_t(it - data), parsing::error };
+
+				m_dict.add(trimmed(cur, colon), { colon + 1, size_t(it - colon - 1) });
+			}
+
+			cur = it + 2;
+			m_last_line_end = cur - data;
+		}
+		return { length, parsing::reading };
+	}
+
+	parsing view_parser::finish(size_t length)
+	{
+		if (m_last_line_end != length)
+			return parsing::error;
+		m_dict.trim();
+		return parsing::separator;
+	}
+
+	void view_parser::reset()
+	{
+		m_dict.clear();
+		m_last_line_end = 0;
+	}
+}};
@@ -99,7 +99,7 @@ inline auto tick_out(const std::string& text)
 	};
 }
 
-inline auto is_selected(const std::shared_ptr<shade::model::bridge>& bridge, const std::string& deviceid)
+inline auto is_selected(const std::shared_ptr<shade::model::bridge>& bridge, shade::model::atom deviceid)
 {
 	return [=]() -> bool { return bridge->host().is_selected(deviceid); };
 }
@@ -243,7 +243,7 @@ void print(const shade::model::group& group, source type)
 {
 	printf("        [%s]: '%s' (%s) %s [%d%%]", group.id().c_str(),
 		group.name().c_str(),
-		group.type() == "Room" ? group.klass().c_str() : group.type().c_str(),
+		group.type().str() == "Room" ? group.klass().c_str() : group.type().c_str(),
 		group.some() ? (group.on() ? "ON" : "SOME") : "OFF",
 		shade::model::mode::clamp(group.bri()) * 100 / shade::model::mode::max_value);
 
@@ -274,10 +274,12 @@ void client::onload(const shade::cache& view)
 	if (view.bridges().empty()) {
 		printf("WAITING FOR BRIDGES...\n");
 	} else {
+		// the menus list the lights and groups of every bridge
 		for (auto& pair : view.bridges()) {
 			auto& ref = local_[pair.first];
 			ref.hw = pair.second->hw();
 			ref.selected.clear();
+			manager_->hydrate(pair.second);
 		}
 
 #if 0
@@ -13,7 +13,7 @@ struct client
 	friend class first_screen;
 
 	struct bridge_info {
-		std::unordered_set<std::string> selected;
+		std::unordered_set<shade::model::atom> selected;
 		shade::model::hw_info hw;
 	};
 	std::unordered_map<std::string, bridge_info> local_;
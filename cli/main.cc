@@ -2,12 +2,19 @@
 #include <shade/asio/network.h>
 #include <shade/asio/http.h>
 #include <shade/version.h>
+#include <cstring>
 #include <iostream>
 
-int main() try {
+int main(int argc, char* argv[]) try {
+	std::string daemon;
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-s") && i + 1 < argc)
+			daemon = argv[++i];
+	}
+
 	boost::asio::io_service service;
 	shade::io::asio::network net{ service };
-	shade::io::asio::http browser{ service };
+	shade::io::asio::http browser{ service, daemon };
 
 	client events{ service };
 	shade::manager hue{ "shade-cli", &events, &net, &browser };
@@ -20,6 +27,8 @@ int main() try {
 	events.manager_ = &hue;
 	hue.search();
 
+	// The client's menu and its listener callbacks share unguarded state,
+	// so the service runs on this thread only; see shade-daemon for -j.
 	service.run();
 } catch (std::exception const & ex) {
 	printf("shade-cli: %s\n", ex.what());
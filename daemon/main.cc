@@ -0,0 +1,99 @@
+#include "server.h"
+#include <shade/listener.h>
+#include <shade/asio/network.h>
+#include <shade/asio/http.h>
+#include <shade/asio/runner.h>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unistd.h>
+
+// Keeps a heartbeat running for every bridge it was allowed to talk to;
+// clients only ever see the results.
+struct events
+	: shade::listener::manager
+	, shade::listener::connection
+{
+	shade::manager* manager_ = nullptr;
+	std::mutex lock_;
+	std::unordered_map<std::string, std::shared_ptr<shade::heart_monitor>> heartbeats_;
+
+	void beat(const std::shared_ptr<shade::model::bridge>& bridge)
+	{
+		auto monitor = manager_->defib(bridge);
+		std::lock_guard<std::mutex> guard{ lock_ };
+		heartbeats_[bridge->id()] = std::move(monitor);
+	}
+
+	// shade::listener::manager
+	void onload(const shade::cache&) override {}
+	void onbridge(const std::shared_ptr<shade::model::bridge>& bridge) override
+	{
+		if (bridge->host().username().empty()) {
+			manager_->connect(bridge);
+			return;
+		}
+
+		beat(bridge);
+	}
+	// the heartbeat starts again once the bridge is back
+	void ongone(const std::shared_ptr<shade::model::bridge>& bridge) override
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		heartbeats_.erase(bridge->id());
+	}
+	shade::listener::connection* connection_listener(const std::shared_ptr<shade::model::bridge>&) override { return this; }
+
+	// shade::listener::connection
+	void onconnecting(const std::shared_ptr<shade::model::bridge>&) override {}
+	void onconnected(const std::shared_ptr<shade::model::bridge>& bridge) override { beat(bridge); }
+	void onfailed(const std::shared_ptr<shade::model::bridge>&) override {}
+	void onlost(const std::shared_ptr<shade::model::bridge>& bridge) override
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		heartbeats_.erase(bridge->id());
+	}
+};
+
+static std::string default_socket()
+{
+	auto runtime = std::getenv("XDG_RUNTIME_DIR");
+	if (runtime && *runtime)
+		return std::string{ runtime } + "/shade.sock";
+	return "/tmp/shade-" + std::to_string(getuid()) + ".sock";
+}
+
+int main(int argc, char* argv[]) try {
+	size_t threads = 1;
+	std::string path = default_socket();
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-j") && i + 1 < argc)
+			threads = std::strtoul(argv[++i], nullptr, 10);
+		else if (!std::strncmp(argv[i], "-j", 2))
+			threads = std::strtoul(argv[i] + 2, nullptr, 10);
+		else if (!std::strcmp(argv[i], "-s") && i + 1 < argc)
+			path = argv[++i];
+	}
+
+	boost::asio::io_service service;
+	shade::io::asio::network net{ service };
+	shade::io::asio::http browser{ service };
+
+	events listener;
+	shade::manager hue{ "shade-daemon", &listener, &net, &browser };
+	if (!hue.ready()) {
+		printf("shade-daemon: could not setup the bridge discovery\n");
+		return 2;
+	}
+
+	listener.manager_ = &hue;
+	server local{ service, path, &hue, &browser };
+
+	hue.search();
+	if (!hue.listen())
+		printf("shade-daemon: could not listen for the bridge announcements\n");
+
+	shade::io::asio::runner{ service, threads }.run();
+} catch (std::exception const & ex) {
+	printf("shade-daemon: %s\n", ex.what());
+}
@@ -0,0 +1,182 @@
+#include "render.h"
+
+using shade::model::source_values;
+namespace mode = shade::model::mode;
+
+// The same shape the bridge uses, so a client cannot tell it is not
+// talking to one.
+static json::map hue_state(json::map out, const source_values& values)
+{
+	int hue = 0, sat = 0, ct = 0;
+	double x = 0, y = 0;
+	std::string colormode = "none";
+	values.value.visit(mode::combine(
+		[&](const mode::hue_sat& hs) { hue = hs.hue; sat = hs.sat; colormode = "hs"; },
+		[&](const mode::xy& xy) { x = xy.x; y = xy.y; colormode = "xy"; },
+		[&](const mode::ct& value) { ct = value.val; colormode = "ct"; }
+	));
+
+	json::vector xy;
+	xy.add(x).add(y);
+
+	out.add("on", values.on)
+		.add("bri", values.bri)
+		.add("hue", hue)
+		.add("sat", sat)
+		.add("ct", ct)
+		.add("xy", xy)
+		.add("colormode", colormode);
+	return out;
+}
+
+json::value hue_lights(const shade::model::bridge_state& bridge)
+{
+	json::map out;
+	for (auto const& light : bridge.lights) {
+		json::map item;
+		item.add("name", light.name)
+			.add("modelid", light.type.str())
+			.add("uniqueid", light.id.str())
+			.add("state", hue_state({}, light));
+		out.add(light.index.str(), item);
+	}
+	return out;
+}
+
+json::value hue_groups(const shade::model::bridge_state& bridge)
+{
+	std::unordered_map<shade::model::atom, std::string> keys;
+	for (auto const& light : bridge.lights)
+		keys[light.id] = light.index.str();
+
+	json::map out;
+	for (auto const& group : bridge.groups) {
+		json::vector lights;
+		for (auto id : group.lights) {
+			auto it = keys.find(id);
+			if (it != keys.end())
+				lights.add(it->second);
+		}
+
+		json::map state;
+		state.add("all_on", group.on).add("any_on", group.some);
+
+		json::map item;
+		item.add("name", group.name)
+			.add("type", group.type.str())
+			.add("class", group.klass)
+			.add("lights", lights)
+			.add("state", state)
+			.add("action", hue_state({}, group));
+		out.add(group.index.str(), item);
+	}
+	return out;
+}
+
+static json::map render(const source_values& values)
+{
+	json::map out;
+	out.add("index", values.index.str())
+		.add("id", values.id.str())
+		.add("name", values.name)
+		.add("type", values.type.str())
+		.add("on", values.on)
+		.add("bri", values.bri);
+
+	values.value.visit(mode::combine(
+		[&](const mode::hue_sat& hs) { out.add("hue", hs.hue).add("sat", hs.sat); },
+		[&](const mode::xy& xy) { out.add("x", xy.x).add("y", xy.y); },
+		[&](const mode::ct& ct) { out.add("ct", ct.val); }
+	));
+
+	if (!values.klass.empty())
+		out.add("class", values.klass);
+	if (values.some)
+		out.add("some", values.some);
+	if (!values.lights.empty()) {
+		json::vector lights;
+		for (auto id : values.lights)
+			lights.add(id.str());
+		out.add("lights", lights);
+	}
+	return out;
+}
+
+static json::value render(const shade::model::bridge_state& bridge)
+{
+	json::vector lights;
+	for (auto const& light : bridge.lights)
+		lights.add(render(light));
+
+	json::vector groups;
+	for (auto const& group : bridge.groups)
+		groups.add(render(group));
+
+	json::map out;
+	out.add("version", (int64_t)bridge.version)
+		.add("base", bridge.hw.base)
+		.add("name", bridge.hw.name)
+		.add("mac", bridge.hw.mac)
+		.add("modelid", bridge.hw.modelid)
+		.add("seen", bridge.seen)
+		.add("lights", lights)
+		.add("groups", groups);
+	return out;
+}
+
+json::value render(const shade::cache_snapshot& snapshot)
+{
+	json::map bridges;
+	for (auto const& pair : snapshot.bridges)
+		bridges.add(pair.first, render(*pair.second));
+
+	json::map out;
+	out.add("version", (int64_t)snapshot.version)
+		.add("bridges", bridges);
+	return out;
+}
+
+static const char* kind_name(shade::model::source_change::kind_t kind)
+{
+	switch (kind) {
+	case shade::model::source_change::added: return "added";
+	case shade::model::source_change::removed: return "removed";
+	default: break;
+	}
+	return "changed";
+}
+
+json::value render(const shade::changes_since& changes)
+{
+	json::map out;
+	out.add("sequence", (int64_t)changes.sequence)
+		.add("resync", changes.resync);
+
+	if (changes.resync) {
+		if (changes.snapshot)
+			out.add("snapshot", render(*changes.snapshot));
+		return out;
+	}
+
+	json::vector sets;
+	for (auto const& set : changes.changes) {
+		json::vector sources;
+		for (auto const& change : set->changes) {
+			json::map item;
+			item.add("kind", kind_name(change.kind))
+				.add("fields", (int64_t)change.fields)
+				.add("values", render(change.kind == shade::model::source_change::removed ? change.before : change.after));
+			sources.add(item);
+		}
+
+		json::map item;
+		item.add("sequence", (int64_t)set->sequence)
+			.add("bridge", set->bridge ? set->bridge->id() : std::string{})
+			.add("sources", sources);
+		if (set->state)
+			item.add("state", render(*set->state));
+		sets.add(item);
+	}
+	out.add("changes", sets);
+	return out;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <shade/snapshot.h>
+#include <shade/change_log.h>
+#include <json.hpp>
+
+json::value hue_lights(const shade::model::bridge_state& bridge);
+json::value hue_groups(const shade::model::bridge_state& bridge);
+json::value render(const shade::cache_snapshot& snapshot);
+json::value render(const shade::changes_since& changes);
@@ -0,0 +1,340 @@
+#include "server.h"
+#include "render.h"
+#include <shade/hue_reply.h>
+#include <shade/io/endpoint.h>
+#include <tangle/msg/http_parser.h>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace boost::asio;
+using boost::system::error_code;
+
+#define MAX_HEADERS (16 * 1024)
+#define MAX_BODY (64 * 1024)
+
+static const char* reason(int status)
+{
+	switch (status) {
+	case 200: return "OK";
+	case 400: return "Bad Request";
+	case 404: return "Not Found";
+	case 413: return "Payload Too Large";
+	case 502: return "Bad Gateway";
+	default: break;
+	}
+	return "Error";
+}
+
+// The bridge answers some resources, like /config, to anyone; only the
+// ones it keeps from unknown users prove the username is whitelisted.
+static bool authorised(const std::string& rest, json::value doc)
+{
+	if (!doc.is<json::MAP>())
+		return false;
+	if (rest == "/lights" || rest == "/groups")
+		return true;
+
+	json::map fields{ doc };
+	if (rest.empty()) {
+		auto it = fields.find("config");
+		if (it == fields.end() || !it->second.is<json::MAP>())
+			return false;
+		fields = json::map{ it->second };
+	} else if (rest != "/config")
+		return false;
+
+	auto it = fields.find("whitelist");
+	return it != fields.end() && it->second.is<json::MAP>();
+}
+
+class session : public std::enable_shared_from_this<session> {
+	server* parent_;
+	local::stream_protocol::socket socket_;
+	streambuf request_;
+	std::string method_;
+	std::string resource_;
+	std::string host_;
+	std::string content_type_;
+	std::string body_;
+	std::string response_;
+
+	void read_headers();
+	void read_body(size_t length);
+	void dispatch();
+	void forward(const std::string& bridge, const shade::io::endpoint& where);
+	void reply(int status, const std::string& body);
+
+	class forwarder;
+public:
+	session(server* parent, io_service& service)
+		: parent_{ parent }
+		, socket_{ service }
+		, request_{ MAX_HEADERS + MAX_BODY }
+	{
+	}
+
+	local::stream_protocol::socket& socket() { return socket_; }
+	void start() { read_headers(); }
+};
+
+class session::forwarder : public shade::io::http::listener {
+	std::shared_ptr<session> session_;
+	std::unique_ptr<shade::io::http::handler> handler_;
+	std::string bridge_;
+	int status_ = 0;
+	std::string body_;
+public:
+	forwarder(std::shared_ptr<session> session, std::string bridge)
+		: session_{ std::move(session) }
+		, bridge_{ std::move(bridge) }
+	{
+	}
+
+	void set_handler(std::unique_ptr<shade::io::http::handler> handler) override
+	{
+		handler_ = std::move(handler);
+	}
+
+	void on_headers(int status, const tangle::cstring&, const shade::io::http::headers&) override
+	{
+		status_ = status;
+	}
+
+	void on_data(const char* data, size_t length) override
+	{
+		if (length) {
+			body_.append(data, length);
+			return;
+		}
+
+		// anything below 100 is a socket error, not a response
+		if (status_ < 100 || status_ > 599) {
+			session_->reply(502, "[]");
+		} else {
+			if (status_ == 200)
+				remember_user();
+			session_->reply(status_, body_);
+		}
+
+		auto session = std::move(session_);
+		handler_.reset();
+	}
+
+	tangle::cstring content_type() override { return session_->content_type_; }
+
+	// A new username from pairing, or one the bridge served a resource
+	// it keeps from unknown users
+	void remember_user()
+	{
+		auto doc = json::from_string(body_);
+		if (session_->method_ == "POST" && (session_->resource_ == "/api" || session_->resource_ == "/api/")) {
+			auto name = shade::hue::username(doc);
+			if (name.is<json::STRING>())
+				session_->parent_->accept_user(bridge_, name.as<json::STRING>());
+			return;
+		}
+
+		std::string username, rest;
+		if (session_->method_ == "GET" && shade::hue::split_api(session_->resource_, username, rest) && authorised(rest, doc))
+			session_->parent_->accept_user(bridge_, username);
+	}
+};
+
+void session::read_headers()
+{
+	auto self = shared_from_this();
+	async_read_until(socket_, request_, "\r\n\r\n", [self, this](const error_code& ec, size_t read) {
+		if (ec)
+			return;
+
+		tangle::msg::http_request parser;
+		auto data = request_.data();
+		auto result = parser.append(buffer_cast<const char*>(data), read);
+		if (std::get<tangle::msg::parsing>(result) != tangle::msg::parsing::separator)
+			return reply(400, "[]");
+		request_.consume(read);
+
+		method_ = parser.method();
+		resource_ = parser.resource();
+
+		auto dict = parser.dict();
+		auto field = [&](const char* name) -> std::string {
+			auto it = dict.find(name);
+			if (it == dict.end() || it->second.empty())
+				return {};
+			return it->second.front();
+		};
+		host_ = field("host");
+		content_type_ = field("content-type");
+		auto length = std::strtoul(field("content-length").c_str(), nullptr, 10);
+		if (length > MAX_BODY)
+			return reply(413, "[]");
+
+		read_body(length);
+	});
+}
+
+void session::read_body(size_t length)
+{
+	if (request_.size() >= length) {
+		auto data = request_.data();
+		body_.assign(buffer_cast<const char*>(data), length);
+		request_.consume(length);
+		return dispatch();
+	}
+
+	auto self = shared_from_this();
+	async_read(socket_, request_, transfer_exactly(length - request_.size()), [self, this, length](const error_code& ec, size_t) {
+		if (ec)
+			return;
+		read_body(length);
+	});
+}
+
+void session::dispatch()
+{
+	auto& hue = parent_->manager();
+	if (method_ == "GET" && resource_ == "/snapshot")
+		return reply(200, render(*hue.snapshot()).to_string());
+
+	static const std::string changes = "/changes";
+	if (method_ == "GET" && !resource_.compare(0, changes.length(), changes)) {
+		std::uint64_t since = 0;
+		auto pos = resource_.find("since=");
+		if (pos != std::string::npos)
+			since = std::strtoull(resource_.c_str() + pos + 6, nullptr, 10);
+		return reply(200, render(hue.poll(since)).to_string());
+	}
+
+	// The bridge is picked by the Host field its endpoint already has
+	auto host_field = "Host: " + host_ + "\r\n";
+	std::shared_ptr<const shade::io::endpoint> where;
+	std::string id;
+	{
+		auto& view = hue.view();
+		auto lock = view.lock();
+		for (auto const& pair : view) {
+			auto& endpoint = pair.second->endpoint();
+			if (endpoint->host_field() == host_field) {
+				where = endpoint;
+				id = pair.first;
+				break;
+			}
+		}
+	}
+
+	if (!where)
+		return reply(404, "[]");
+
+	auto bridge = hue.snapshot()->get(id);
+	std::string username, rest;
+	if (bridge && method_ == "GET" && bridge->hydrated && shade::hue::split_api(resource_, username, rest)
+		&& parent_->accepted(*bridge, username)) {
+		if (rest == "/lights")
+			return reply(200, hue_lights(*bridge).to_string());
+		if (rest == "/groups")
+			return reply(200, hue_groups(*bridge).to_string());
+	}
+
+	forward(id, *where);
+}
+
+void session::forward(const std::string& bridge, const shade::io::endpoint& where)
+{
+	auto browser = parent_->browser();
+	auto client = std::make_unique<forwarder>(shared_from_this(), bridge);
+
+	if (method_ == "GET")
+		browser->get(where, {}, resource_, std::move(client));
+	else if (method_ == "DELETE")
+		browser->del(where, {}, resource_, std::move(client));
+	else if (method_ == "PUT")
+		browser->put(where, {}, resource_, body_, std::move(client));
+	else if (method_ == "POST")
+		browser->post(where, {}, resource_, body_, std::move(client));
+	else
+		reply(400, "[]");
+}
+
+void session::reply(int status, const std::string& body)
+{
+	char head[256];
+	snprintf(head, sizeof(head),
+		"HTTP/1.0 %d %s\r\n"
+		"Content-Type: application/json\r\n"
+		"Content-Length: %zu\r\n"
+		"Connection: close\r\n\r\n",
+		status, reason(status), body.length());
+
+	response_ = head;
+	response_.append(body);
+
+	auto self = shared_from_this();
+	async_write(socket_, buffer(response_), [self, this](const error_code&, size_t) {
+		error_code ignored;
+		socket_.shutdown(local::stream_protocol::socket::shutdown_both, ignored);
+	});
+}
+
+server::server(io_service& service, const std::string& path, shade::manager* manager, shade::io::http* browser)
+	: service_{ service }
+	, acceptor_{ service }
+	, manager_{ manager }
+	, browser_{ browser }
+{
+	local::stream_protocol::endpoint where{ path };
+
+	// A daemon still answering keeps its socket; only a stale one is
+	// taken over.
+	{
+		local::stream_protocol::socket probe{ service };
+		error_code ec;
+		probe.connect(where, ec);
+		if (!ec)
+			throw std::runtime_error{ "another daemon is listening on " + path };
+		if (ec == error::connection_refused)
+			::unlink(path.c_str());
+	}
+
+	acceptor_.open(where.protocol());
+
+	// nobody else may connect, even in a shared directory
+	auto mask = ::umask(0077);
+	error_code ec;
+	acceptor_.bind(where, ec);
+	::umask(mask);
+	if (ec)
+		throw boost::system::system_error{ ec };
+
+	acceptor_.listen();
+	accept();
+}
+
+void server::accept()
+{
+	auto next = std::make_shared<session>(this, service_);
+	acceptor_.async_accept(next->socket(), [this, next](const error_code& ec) {
+		if (!ec)
+			next->start();
+		accept();
+	});
+}
+
+bool server::accepted(const shade::model::bridge_state& bridge, const std::string& username)
+{
+	if (username == bridge.username)
+		return true;
+
+	std::lock_guard<std::mutex> guard{ users_lock_ };
+	auto it = users_.find(bridge.id);
+	return it != users_.end() && it->second.count(username);
+}
+
+void server::accept_user(const std::string& bridge, const std::string& username)
+{
+	std::lock_guard<std::mutex> guard{ users_lock_ };
+	users_[bridge].insert(username);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <shade/manager.h>
+#include <shade/io/http.h>
+#include <boost/asio.hpp>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// Serves the state kept by one manager to local clients. Reads of lights
+// and groups come from the cache, everything else goes to the bridge.
+class server {
+	boost::asio::io_service& service_;
+	boost::asio::local::stream_protocol::acceptor acceptor_;
+	shade::manager* manager_;
+	shade::io::http* browser_;
+	std::mutex users_lock_;
+	std::unordered_map<std::string, std::unordered_set<std::string>> users_;
+
+	void accept();
+public:
+	server(boost::asio::io_service& service, const std::string& path, shade::manager* manager, shade::io::http* browser);
+
+	shade::manager& manager() const { return *manager_; }
+	shade::io::http* browser() const { return browser_; }
+
+	// Usernames from pairing, or ones the bridge served its lights, groups
+	// or whitelist to; only those are served from the cache.
+	bool accepted(const shade::model::bridge_state& bridge, const std::string& username);
+	void accept_user(const std::string& bridge, const std::string& username);
+};
@@ -8,10 +8,20 @@ namespace shade { namespace io { namespace asio {
 
 	class http : public io::http {
 		io_service& service_;
+		std::string local_;
 		bool send(method method, const tangle::uri& address, const std::string& data, listener_ptr client) override;
+		bool send(method method, const endpoint& where, const std::string& root, const std::string& resource, const std::string& data, listener_ptr client) override;
+		bool send(method method, const std::string& host, const std::string& service, const std::string& host_field,
+			const tangle::cstring& root, const tangle::cstring& resource, const std::string& data, listener_ptr client);
+		template <typename Handler>
+		static bool prepare(Handler& handler, method method, const std::string& host_field,
+			const tangle::cstring& root, const tangle::cstring& resource, const std::string& data);
 	public:
-		http(io_service& service)
+		// With a local path, every request goes over that Unix socket to
+		// shade-daemon, instead of to the bridge.
+		explicit http(io_service& service, std::string local = {})
 			: service_{ service }
+			, local_{ std::move(local) }
 		{}
 	};
 } } }
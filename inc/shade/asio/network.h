@@ -14,5 +14,7 @@ namespace shade { namespace io { namespace asio {
 		std::unique_ptr<io::udp> udp_socket() override;
 		std::unique_ptr<io::tcp> tcp_socket() override;
 		std::unique_ptr<io::timeout> timeout(milliseconds duration, std::function<void()> && cb) override;
+		std::unique_ptr<io::strand> make_strand() override;
+		std::vector<uint32_t> interfaces() override;
 	};
 } } }
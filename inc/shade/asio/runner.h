@@ -0,0 +1,23 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <thread>
+#include <vector>
+
+namespace shade { namespace io { namespace asio {
+	using namespace boost::asio;
+
+	// Drives one io_service from a number of threads. Handlers touching a
+	// single bridge are kept apart by the bridge's strand.
+	class runner {
+		io_service& service_;
+		size_t threads_;
+	public:
+		runner(io_service& service, size_t threads = std::thread::hardware_concurrency())
+			: service_{ service }
+			, threads_{ threads ? threads : 1 }
+		{}
+
+		void run();
+	};
+} } }
@@ -1,6 +1,8 @@
 #pragma once
 #include <array>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -8,38 +10,81 @@
 #include <shade/model/bridge.h>
 #include <shade/io/http.h>
 #include <shade/hue_data.h>
+#include <shade/change_log.h>
 #include <shade/listener.h>
+#include <shade/snapshot.h>
 
 namespace shade {
 	using bridges_t = std::unordered_map<std::string, std::shared_ptr<model::bridge>>;
+	// The bridges and their light sources may be updated from several
+	// threads; anything reading or changing them outside of the methods
+	// below should hold lock(). Readers that only need the values can
+	// take snapshot() instead, which never blocks.
 	class cache {
 		io::http* browser_;
 		std::string clientid;
 		bridges_t known_bridges;
+		std::shared_ptr<model::atom_table> atoms_ = std::make_shared<model::atom_table>();
+		mutable std::recursive_mutex lock_;
+		std::shared_ptr<const cache_snapshot> snapshot_ = std::make_shared<cache_snapshot>();
+		change_log log_;
+
+		std::uint64_t publish(const std::shared_ptr<model::bridge>& bridge);
+		void publish_all();
+		void announce(const std::shared_ptr<model::bridge>& bridge);
+		void deliver(const std::shared_ptr<model::bridge>& bridge, model::change_set& set,
+			listener::storage* storage, listener::bridge* changes);
 	public:
+		using guard = std::unique_lock<std::recursive_mutex>;
+
 		cache(const std::string& client, io::http* browser) : browser_{ browser }, clientid{ client } {}
+		guard lock() const { return guard{ lock_ }; }
 		io::http* browser() const { return browser_; }
+		const std::shared_ptr<model::atom_table>& atoms() const { return atoms_; }
 		const std::string& current_host() const { return clientid; }
 		auto const& bridges() const { return known_bridges; }
-		void bridges(const bridges_t& v) { known_bridges = v; }
-		void bridges(bridges_t&& v) { known_bridges = std::move(v); }
+		void bridges(const bridges_t& v);
+		void bridges(bridges_t&& v);
+		std::shared_ptr<const cache_snapshot> snapshot() const { return std::atomic_load(&snapshot_); }
+		changes_since changes(std::uint64_t since) const;
 		auto find(const std::string& id) const { return known_bridges.find(id); }
 		auto begin() const { return known_bridges.begin(); }
 		auto end() const { return known_bridges.end(); }
 		std::shared_ptr<model::bridge> get(const std::string& id) const
 		{
+			auto lock = this->lock();
 			auto it = find(id);
 			if (it != end())
 				return it->second;
 			return {};
 		}
 
+		void hydrate(const std::shared_ptr<model::bridge>& bridge);
 		void bridge_located(const std::string& id, const std::string& base, listener::storage* storage);
 		void bridge_named(const std::string& id, std::string name, std::string mac, std::string modelid, listener::storage* storage);
 		void bridge_connected(const std::shared_ptr<model::bridge>& bridge, const std::string& username, listener::storage* storage);
-		void bridge_lights(const std::shared_ptr<model::bridge>& bridge,
-			std::unordered_map<std::string, hue::light> lights,
-			std::unordered_map<std::string, hue::group> groups,
+		void bridge_gone(const std::shared_ptr<model::bridge>& bridge);
+		void bridge_changed(const std::shared_ptr<model::bridge>& bridge, model::bridge_diff& diff,
+			listener::storage* storage, listener::bridge* changes);
+		void bridge_pending(const std::shared_ptr<model::bridge>& bridge, std::uint64_t request, const model::patch_list& targets,
+			listener::storage* storage, listener::bridge* changes);
+		void bridge_settled(const std::shared_ptr<model::bridge>& bridge, std::uint64_t request, const std::vector<model::atom>& ids, std::uint32_t rejected,
 			listener::storage* storage, listener::bridge* changes);
 	};
+
+	// Cursor over the cache's change log, for consumers that read at
+	// their own pace instead of listening.
+	class subscription {
+		const cache* view_;
+		std::uint64_t last_;
+	public:
+		subscription(const cache* view, std::uint64_t last = 0) : view_{ view }, last_{ last } {}
+		std::uint64_t last() const { return last_; }
+		changes_since poll()
+		{
+			auto out = view_->changes(last_);
+			last_ = out.sequence;
+			return out;
+		}
+	};
 }
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <shade/model/change_set.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace shade {
+	struct cache_snapshot;
+
+	struct changes_since {
+		bool resync = false;
+		std::uint64_t sequence = 0; // the `since` to ask for next time
+		std::vector<std::shared_ptr<const model::change_set>> changes;
+		std::shared_ptr<const cache_snapshot> snapshot; // only with resync
+	};
+
+	// Bounded ring of the most recent change sets, oldest first. A
+	// consumer that falls further behind than the ring reaches has to
+	// start over from a snapshot.
+	class change_log {
+		mutable std::mutex lock_;
+		std::vector<std::shared_ptr<const model::change_set>> ring_;
+		size_t head_ = 0;
+		size_t size_ = 0;
+		std::uint64_t dropped_ = 0; // sequence of the newest set no longer kept
+	public:
+		explicit change_log(size_t capacity = 1024);
+
+		void push(std::shared_ptr<const model::change_set> set);
+		void reset(std::uint64_t sequence);
+		bool since(std::uint64_t sequence, std::vector<std::shared_ptr<const model::change_set>>& out) const;
+	};
+}
@@ -2,28 +2,57 @@
 
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <shade/io/network.h>
+#include <shade/io/http.h>
 
 namespace shade {
+	class discovery_handler;
 	class discovery {
+		friend class discovery_handler;
+
 		bool connected_ = false;
 		io::network* net_;
-		std::unique_ptr<io::udp> udp_socket_;
-		std::unique_ptr<io::read_handler> current_search_;
+		io::http* browser_;
+		std::shared_ptr<io::strand> strand_;
+		std::vector<std::unique_ptr<io::udp>> sockets_; // one per interface
+		std::vector<std::unique_ptr<io::read_handler>> current_search_;
+		std::unique_ptr<io::udp> notify_socket_;
+		std::unique_ptr<io::read_handler> listening_;
+		std::unique_ptr<io::timeout> relisten_;
 
 		struct bridge_info {
-			std::string location;
+			std::string location; // as announced
 			std::string base;
 		};
-		std::unordered_map<std::string, bridge_info> known_bridges_;
+		struct known_table {
+			std::mutex lock;
+			std::unordered_map<std::string, bridge_info> bridges;
+		};
+		std::unique_ptr<known_table> known_;
 
 	public:
-		using onbridge = std::function<void(const std::string& id, const std::string& base)>;
+		// Name, mac and modelid come from the bridge's description.xml;
+		// they are empty if it could not be fetched or did not match.
+		struct description {
+			std::string id;
+			std::string base;
+			std::string name;
+			std::string mac;
+			std::string modelid;
+
+			bool described() const { return !modelid.empty(); }
+		};
+
+		using onbridge = std::function<void(const description&)>;
 		using ondone = std::function<void()>;
-		discovery(io::network* net);
+		using ongone = std::function<void(const std::string& id)>;
+		discovery(io::network* net, io::http* browser);
 		discovery(const discovery&) = delete;
 		discovery(discovery&&);
 		discovery& operator=(const discovery&) = delete;
@@ -31,9 +60,28 @@ namespace shade {
 		~discovery();
 
 		bool ready() const { return connected_; }
-		bool search(onbridge callback, ondone done);
+		// With expected ids, done is called as soon as all of them have
+		// answered; the search keeps listening for new bridges until the
+		// timeout either way.
+		bool search(onbridge callback, ondone done, std::unordered_set<std::string> expected = {});
+		// Joins the SSDP group and reports the bridges announcing
+		// themselves, new ones and the ones with a new address, and the
+		// ones saying goodbye, until the discovery is destroyed. A read
+		// that fails is started again after a while.
+		bool listen(onbridge callback, ongone gone);
 
+		// Safe to call from the datagram callbacks; does not allocate.
+		bool known(const std::string& id, const tangle::cstring& location) const;
 		bool seen(const std::string& id, const std::string& location);
 		bool base_known(const std::string& id, const std::string& base);
+		void forget(const std::string& id);
+
+	private:
+		onbridge announced_;
+		ongone gone_;
+
+		bool listen();
+		void relisten();
+		void byebye(const std::string& id);
 	};
 }
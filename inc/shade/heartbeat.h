@@ -3,6 +3,8 @@
 #include <shade/discovery.h>
 #include <shade/cache.h>
 #include <shade/io/http.h>
+#include <shade/workers.h>
+#include <atomic>
 
 namespace shade {
 	namespace hue {
@@ -20,7 +22,7 @@ namespace shade {
 
 	class heartbeat : public std::enable_shared_from_this<heartbeat> {
 	public:
-		heartbeat(cache* view, listener::manager* listener, io::network* net, const std::shared_ptr<model::bridge>& bridge);
+		heartbeat(cache* view, listener::manager* listener, io::network* net, workers* pool, const std::shared_ptr<model::bridge>& bridge);
 		heartbeat() = delete;
 		heartbeat(heartbeat&&) = delete;
 		heartbeat(const heartbeat&) = delete;
@@ -28,16 +30,21 @@ namespace shade {
 		heartbeat& operator=(const heartbeat&) = delete;
 
 		void stop();
-		void start() { tick(); }
+		void start();
 	private:
 		cache* view_;
 		listener::manager* listener_;
 		io::network* net_;
+		workers* pool_;
 		std::shared_ptr<model::bridge> bridge_;
+		std::unique_ptr<io::strand> strand_;
 		std::unique_ptr<io::timeout> timeout_;
+		std::atomic<bool> stopped_{ false };
 
 		bool reconnect(json::value doc);
 
 		void tick();
+		void decode(json::value lights, json::value groups, const model::bridge_snapshot& snapshot);
+		void apply(model::bridge_diff& diff);
 	};
 }
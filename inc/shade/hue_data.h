@@ -2,6 +2,7 @@
 #include <string>
 #include <array>
 #include <vector>
+#include <unordered_map>
 
 namespace shade { namespace hue {
 	struct config {
@@ -41,12 +42,29 @@ namespace shade { namespace hue {
 		light_state state;
 	};
 
+	using light_map = std::unordered_map<std::string, light>;
+	using group_map = std::unordered_map<std::string, group>;
+
+	// Result of one heartbeat; the cache and the bridge consume it in
+	// place, leaving the entries in a moved-from state.
+	struct sources {
+		light_map lights;
+		group_map groups;
+	};
+
 	struct error_type {
 		int type;
 		std::string address;
 		std::string description;
 	};
 
+	// A reply to PUT /state or /action: the addresses the bridge set,
+	// e.g. "/lights/1/state/on", and the errors for the ones it did not.
+	struct put_reply {
+		std::vector<std::string> applied;
+		std::vector<error_type> errors;
+	};
+
 	enum class errors {
 		unauthorised_user = 1,
 		invalid_json = 2,
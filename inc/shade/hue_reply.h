@@ -0,0 +1,18 @@
+#pragma once
+#include <shade/hue_data.h>
+#include <json.hpp>
+#include <string>
+
+namespace shade { namespace hue {
+	// The first error of a reply, if it is one
+	bool get_error(error_type& error, json::value doc);
+	bool get_error(errors& code, json::value doc);
+
+	bool get_put_reply(put_reply& reply, json::value doc);
+
+	// The username given by a bridge in reply to the pairing request
+	json::value username(json::value doc);
+
+	// "/api/<username>/<rest>" -> username, rest
+	bool split_api(const std::string& resource, std::string& username, std::string& rest);
+} }
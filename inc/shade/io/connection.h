@@ -1,27 +1,26 @@
 #pragma once
 
 #include <shade/io/http.h>
+#include <memory>
 
 namespace shade { namespace io {
 	class connection {
-		http* browser_;
-		tangle::uri base_;
+		http* browser_ = nullptr;
+		std::shared_ptr<const endpoint> endpoint_;
 		std::string id_;
 		std::string root_ = "/api";
-
-		tangle::uri uri_with(const std::string& resource) const {
-			return tangle::uri{ base_ }.path(root_ + resource);
-		}
 	public:
 		connection() = default;
-		connection(http* browser, const tangle::uri& base, const std::string& id, const std::string& root = "/api")
+		connection(http* browser, std::shared_ptr<const endpoint> where, const std::string& id, const std::string& root = "/api")
 			: browser_{ browser }
-			, base_{ base }
+			, endpoint_{ std::move(where) }
 			, id_{ id }
 			, root_{ root }
 		{
 		}
 		const std::string& id() const { return id_; }
+		http* browser() const { return browser_; }
+		const std::shared_ptr<const endpoint>& where() const { return endpoint_; }
 
 		connection logged(const std::string& username) const;
 		connection unlogged() const;
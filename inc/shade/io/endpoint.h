@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+namespace shade { namespace io {
+	// Parts of every request to a given base address, rendered once.
+	class endpoint {
+		std::string base_;
+		std::string host_;
+		std::string service_;
+		std::string host_field_;
+	public:
+		endpoint() = default;
+		explicit endpoint(const std::string& base);
+
+		const std::string& base() const { return base_; }
+		const std::string& host() const { return host_; }
+		const std::string& service() const { return service_; }
+		const std::string& host_field() const { return host_field_; }
+	};
+} }
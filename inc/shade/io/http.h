@@ -1,13 +1,14 @@
 #pragma once
 
+#include <shade/io/endpoint.h>
 #include <tangle/uri.h>
-#include <tangle/msg/http_parser.h>
+#include <tangle/msg/view_parser.h>
 #include <memory>
 
 namespace shade{ namespace io {
 	struct http {
-		using response = tangle::msg::http_response;
-		using headers = response::dict_t;
+		using response = tangle::msg::http_response_view;
+		using headers = tangle::msg::dict_view;
 
 		struct handler {
 			virtual ~handler() = default;
@@ -30,6 +31,11 @@ namespace shade{ namespace io {
 		auto put(const tangle::uri& address, const std::string& data, listener_ptr listener) { return send(method::PUT, address, data, std::move(listener)); }
 		auto post(const tangle::uri& address, const std::string& data, listener_ptr listener) { return send(method::POST, address, data, std::move(listener)); }
 
+		auto get(const endpoint& where, const std::string& root, const std::string& resource, listener_ptr listener) { return send(method::GET, where, root, resource, {}, std::move(listener)); }
+		auto del(const endpoint& where, const std::string& root, const std::string& resource, listener_ptr listener) { return send(method::DEL, where, root, resource, {}, std::move(listener)); }
+		auto put(const endpoint& where, const std::string& root, const std::string& resource, const std::string& data, listener_ptr listener) { return send(method::PUT, where, root, resource, data, std::move(listener)); }
+		auto post(const endpoint& where, const std::string& root, const std::string& resource, const std::string& data, listener_ptr listener) { return send(method::POST, where, root, resource, data, std::move(listener)); }
+
 	protected:
 		enum class method {
 			GET,
@@ -40,5 +46,9 @@ namespace shade{ namespace io {
 
 	private:
 		virtual bool send(method method, const tangle::uri& address, const std::string& data, listener_ptr listener) = 0;
+		virtual bool send(method method, const endpoint& where, const std::string& root, const std::string& resource, const std::string& data, listener_ptr listener)
+		{
+			return send(method, tangle::uri{ where.base() }.path(root + resource), data, std::move(listener));
+		}
 	};
 } }
\ No newline at end of file
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <vector>
 
 namespace shade { namespace io {
 	struct read_handler {
@@ -11,7 +13,12 @@ namespace shade { namespace io {
 	struct udp {
 		virtual ~udp() = default;
 		virtual bool bind(uint16_t) = 0;
+		virtual bool bind(uint32_t local, uint16_t port) = 0;
+		virtual bool multicast_interface(uint32_t local) = 0;
+		virtual bool reuse_address() = 0;
+		virtual bool join_group(uint32_t group, uint32_t local) = 0;
 		virtual bool write_datagram(const uint8_t* data, size_t length, uint32_t ip, uint16_t port) = 0;
+		// A zero duration reads until the handler is destroyed.
 		virtual std::unique_ptr<read_handler> read_datagram(std::chrono::milliseconds duration, std::function<void(const uint8_t*, size_t, bool)> && cb) = 0;
 	};
 
@@ -24,10 +31,24 @@ namespace shade { namespace io {
 	};
 
 	using std::chrono::milliseconds;
+
+	// Callbacks posted to one strand never run concurrently, even if the
+	// network is driven by several threads.
+	struct strand {
+		virtual ~strand() = default;
+		virtual void post(std::function<void()> && cb) = 0;
+		virtual std::unique_ptr<io::timeout> timeout(milliseconds duration, std::function<void()> && cb) = 0;
+	};
+
 	struct network {
 		virtual ~network() = default;
 		virtual std::unique_ptr<udp> udp_socket() = 0;
 		virtual std::unique_ptr<tcp> tcp_socket() = 0;
 		virtual std::unique_ptr<io::timeout> timeout(milliseconds duration, std::function<void()> && cb) = 0;
+		virtual std::unique_ptr<io::strand> make_strand() = 0;
+
+		// IPv4 addresses (host order) of the interfaces able to send
+		// multicast; empty when they cannot be listed.
+		virtual std::vector<uint32_t> interfaces() { return {}; }
 	};
 } }
\ No newline at end of file
@@ -1,12 +1,8 @@
 #pragma once
+#include <shade/model/change_set.h>
 #include <memory>
 
 namespace shade {
-	namespace model {
-		class bridge;
-		class light_source;
-	}
-
 	class cache;
 
 	namespace listener {
@@ -30,12 +26,29 @@ namespace shade {
 			virtual void source_removed(const std::shared_ptr<model::light_source>&) = 0;
 			virtual void source_changed(const std::shared_ptr<model::light_source>&) = 0;
 			virtual void update_end(const std::shared_ptr<model::bridge>&) = 0;
+
+			// Called once per update; by default replays the change set
+			// through the per-source callbacks above.
+			virtual void changed(const model::change_set& changes)
+			{
+				update_start(changes.bridge);
+				for (auto const& change : changes.changes) {
+					switch (change.kind) {
+					case model::source_change::added: source_added(change.source); break;
+					case model::source_change::removed: source_removed(change.source); break;
+					case model::source_change::changed: source_changed(change.source); break;
+					}
+				}
+				update_end(changes.bridge);
+			}
 		};
 
 		struct manager {
 			virtual ~manager() = default;
 			virtual void onload(const shade::cache&) = 0;
 			virtual void onbridge(const std::shared_ptr<model::bridge>&) = 0;
+			// The bridge announced it is leaving the network
+			virtual void ongone(const std::shared_ptr<model::bridge>&) {}
 			virtual connection* connection_listener(const std::shared_ptr<model::bridge>&) { return nullptr; }
 			virtual bridge* bridge_listener(const std::shared_ptr<model::bridge>&) { return nullptr; }
 		};
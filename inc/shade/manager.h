@@ -3,7 +3,13 @@
 #include <shade/discovery.h>
 #include <shade/cache.h>
 #include <shade/io/http.h>
+#include <shade/workers.h>
+#include <shade/model/pending.h>
+#include <shade/model/planner.h>
 #include <json.hpp>
+#include <cstdint>
+#include <functional>
+#include <mutex>
 
 namespace shade {
 	namespace hue {
@@ -24,84 +30,170 @@ namespace shade {
 	};
 
 	class manager;
+	// The body is rendered once, the first time it is needed, and kept
+	// until the next change.
 	class change_def {
 		friend class manager;
-		json::map opts_;
-		void erase(const std::string& key)
+		enum field : std::uint8_t {
+			field_on      = 1 << 0,
+			field_bri     = 1 << 1,
+			field_hue_sat = 1 << 2,
+			field_xy      = 1 << 3,
+			field_ct      = 1 << 4,
+			field_color   = field_hue_sat | field_xy | field_ct
+		};
+
+		std::uint8_t fields_ = 0;
+		bool on_ = false;
+		int bri_ = 0;
+		model::mode::hue_sat hue_sat_{};
+		model::mode::xy xy_{};
+		model::mode::ct ct_{};
+		mutable std::string body_;
+
+		change_def& set(std::uint8_t fields)
 		{
-			auto it = opts_.find(key);
-			if (it != opts_.end())
-				opts_.erase(it);
+			fields_ |= fields;
+			body_.clear();
+			return *this;
 		}
+
+		change_def& erase(std::uint8_t fields)
+		{
+			fields_ &= ~fields;
+			body_.clear();
+			return *this;
+		}
+
+		void render() const;
 	public:
 		change_def& on(bool val)
 		{
-			opts_.add("on", val);
-			return *this;
+			on_ = val;
+			return set(field_on);
 		}
 
 		change_def& bri(int val)
 		{
-			opts_.add("bri", model::mode::clamp(val));
-			return *this;
+			bri_ = model::mode::clamp(val);
+			return set(field_bri);
 		}
 
 		change_def& color(const model::color_mode& color)
 		{
-			erase("hue");
-			erase("sat");
-			erase("xy");
-			erase("ct");
+			erase(field_color);
 			color.visit(model::mode::combine(
-				[&](const model::mode::hue_sat& hs) { opts_.add("hue", hs.hue).add("sat", hs.sat); },
-				[&](const model::mode::xy& xy) { json::vector v; v.add(xy.x).add(xy.y); opts_.add("xy", v); },
-				[&](const model::mode::ct& ct) { opts_.add("ct", ct.val); }
+				[&](const model::mode::hue_sat& hs) { hue_sat_ = hs; set(field_hue_sat); },
+				[&](const model::mode::xy& xy) { xy_ = xy; set(field_xy); },
+				[&](const model::mode::ct& ct) { ct_ = ct; set(field_ct); }
 			));
 			return *this;
 		}
 
 		change_def& erase_on()
 		{
-			erase("on");
-			return *this;
+			return erase(field_on);
 		}
 
 		change_def& erase_bri()
 		{
-			erase("bri");
-			return *this;
+			return erase(field_bri);
 		}
 
 		change_def& erase_color()
 		{
-			return color({});
+			return erase(field_color);
+		}
+
+		model::source_patch patch() const;
+
+		const std::string& body() const
+		{
+			if (body_.empty())
+				render();
+			return body_;
 		}
+
+		bool operator == (const change_def& rhs) const;
+		bool operator != (const change_def& rhs) const { return !(*this == rhs); }
+	};
+
+	struct update_result {
+		int status = 0;             // HTTP status, 0 if the request was never sent
+		std::uint32_t applied = 0;  // model::source_field bits the bridge set
+		std::uint32_t rejected = 0; // the ones it refused; all, if the reply made no sense
+		std::vector<hue::error_type> errors;
+		bool superseded = false;    // a later item changed some of its lights to another state
+
+		bool ok() const { return status / 100 == 2 && !rejected && errors.empty(); }
+
+		// the bridge was too busy, the command may be sent again later
+		bool throttled() const
+		{
+			for (auto const& error : errors) {
+				if (error.type == (int)hue::errors::internal_error)
+					return true;
+			}
+			return false;
+		}
+	};
+
+	// The result of a single command, from the bridge's reply to it; asked
+	// holds the model::source_field bits the command sets.
+	update_result command_result(std::uint32_t asked, int status, json::value doc);
+
+	// One result per item of the change list, in the same order. An item
+	// superseded for all of its lights is never sent and not counted as
+	// failed.
+	struct batch_result {
+		std::vector<update_result> items;
+		size_t failed = 0;
 	};
 
 	class manager {
 	public:
+		using change_list = std::vector<std::pair<std::shared_ptr<model::light_source>, change_def>>;
+		using onbatch = std::function<void(const batch_result&)>;
+
 		manager(const std::string& name, listener::manager* listener, io::network* net, io::http* browser);
 
 		const auto& current_host() const { return view_.current_host(); }
 		bool ready() const { return discovery_.ready(); }
 		const cache& view() const { return view_; }
+		std::shared_ptr<const cache_snapshot> snapshot() const { return view_.snapshot(); }
+		subscription subscribe(std::uint64_t since = 0) const { return { &view_, since }; }
+		changes_since poll(std::uint64_t since) const { return view_.changes(since); }
 		void store_cache();
 		void search();
+		bool listen();
 		void connect(const std::shared_ptr<model::bridge>&);
+		void hydrate(const std::shared_ptr<model::bridge>& bridge) { view_.hydrate(bridge); }
 		std::shared_ptr<heart_monitor> defib(const std::shared_ptr<model::bridge>&);
 		void update(const std::shared_ptr<shade::model::light_source>& source, const change_def& change);
+		// Each bridge gets its own queue, all of them sent in parallel;
+		// done is called from the network thread, after the last reply.
+		void update(const change_list& changes, onbatch done = {});
+		void budget(const model::rate_budget& value) { budget_ = value; }
+		// Applies updates to the model as they are sent, rolling them
+		// back if the bridge refuses them.
+		void optimistic(bool value) { optimistic_ = value; }
 	private:
 		listener::manager* listener_;
 		io::network* net_;
 		cache view_;
-		discovery discovery_{ net_ };
+		discovery discovery_{ net_, view_.browser() };
+		std::mutex timeouts_lock_;
 		std::unordered_map<std::string, std::unique_ptr<io::timeout>> timeouts_;
+		model::rate_budget budget_;
+		bool optimistic_ = false;
+		std::uint64_t requests_ = 0;
+		workers workers_;
 
+		void bridge_found(const discovery::description& found);
+		void bridge_gone(const std::string& id);
 		void get_config(const io::connection& conn);
 
 		void connect(const std::shared_ptr<model::bridge>&, std::chrono::nanoseconds sofar);
 		void getuser(const std::shared_ptr<model::bridge>& bridge, int status, json::value doc, std::chrono::nanoseconds sofar, std::chrono::steady_clock::time_point then);
-
-		void do_update(const std::shared_ptr<shade::model::light_source>& source, const change_def& change);
 	};
 }
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace shade { namespace model {
+	// Per-bridge slab allocator for light sources. Freed blocks are kept on
+	// a free list for their size and reused by the next allocation of the
+	// same size, so rebuilding the sources of a bridge does not go back to
+	// the global heap.
+	class arena {
+	public:
+		arena() = default;
+		arena(const arena&) = delete;
+		arena& operator=(const arena&) = delete;
+
+		void* allocate(size_t size);
+		void deallocate(void* ptr, size_t size);
+	private:
+		static constexpr size_t alignment = alignof(std::max_align_t);
+		static constexpr size_t max_block = 1024;
+		static constexpr size_t slab_size = 32 * 1024;
+
+		struct block {
+			block* next;
+		};
+
+		struct free_list {
+			size_t size;
+			block* head;
+		};
+
+		std::mutex lock_;
+		std::vector<free_list> free_;
+		std::vector<std::unique_ptr<char[]>> slabs_;
+		char* current_ = nullptr;
+		size_t left_ = 0;
+
+		static size_t round_up(size_t size) { return (size + alignment - 1) / alignment * alignment; }
+		block*& head(size_t size);
+	};
+
+	template <typename T>
+	class arena_allocator {
+		template <typename U> friend class arena_allocator;
+		std::shared_ptr<arena> arena_;
+	public:
+		using value_type = T;
+
+		arena_allocator(std::shared_ptr<arena> pool) : arena_{ std::move(pool) } {}
+		template <typename U>
+		arena_allocator(const arena_allocator<U>& rhs) : arena_{ rhs.arena_ } {}
+
+		T* allocate(size_t n) { return static_cast<T*>(arena_->allocate(n * sizeof(T))); }
+		void deallocate(T* ptr, size_t n) { arena_->deallocate(ptr, n * sizeof(T)); }
+
+		template <typename U>
+		bool operator == (const arena_allocator<U>& rhs) const { return arena_ == rhs.arena_; }
+		template <typename U>
+		bool operator != (const arena_allocator<U>& rhs) const { return arena_ != rhs.arena_; }
+	};
+
+	template <typename T, typename... Args>
+	inline std::shared_ptr<T> allocate_shared(const std::shared_ptr<arena>& pool, Args&&... args)
+	{
+		if (!pool)
+			return std::make_shared<T>(std::forward<Args>(args)...);
+		return std::allocate_shared<T>(arena_allocator<T>{ pool }, std::forward<Args>(args)...);
+	}
+} }
@@ -0,0 +1,46 @@
+#pragma once
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace shade { namespace model {
+	class atom_table;
+
+	// Handle to a string interned in an atom_table. Two atoms from the same
+	// table are equal if and only if they point to the same entry.
+	class atom {
+		friend class atom_table;
+		const std::string* value_ = nullptr;
+		explicit atom(const std::string* value) : value_{ value } {}
+	public:
+		atom() = default;
+
+		const std::string& str() const;
+		const char* c_str() const { return str().c_str(); }
+		bool empty() const { return !value_; }
+		size_t hash() const { return std::hash<const void*>{}(value_); }
+
+		bool operator == (const atom& rhs) const { return value_ == rhs.value_; }
+		bool operator != (const atom& rhs) const { return value_ != rhs.value_; }
+	};
+
+	class atom_table {
+		mutable std::mutex lock_;
+		std::unordered_set<std::string> strings_;
+	public:
+		atom intern(const std::string& value);
+		atom find(const std::string& value) const;
+		size_t size() const;
+	};
+} }
+
+namespace std {
+	template <>
+	struct hash<shade::model::atom> {
+		size_t operator()(const shade::model::atom& key) const
+		{
+			return key.hash();
+		}
+	};
+}
@@ -1,7 +1,10 @@
 #pragma once
+#include <shade/model/change_set.h>
+#include <shade/model/diff.h>
 #include <shade/model/host.h>
 #include <shade/model/light.h>
 #include <shade/model/group.h>
+#include <shade/model/pending.h>
 #include <shade/io/connection.h>
 #include <shade/io/http.h>
 #include <vector>
@@ -11,6 +14,7 @@
 namespace json {
 	struct struct_translator;
 	struct value;
+	struct map;
 }
 
 namespace shade { namespace hue {
@@ -18,10 +22,6 @@ namespace shade { namespace hue {
 	struct group;
 } }
 
-namespace shade { namespace listener {
-	struct bridge;
-} }
-
 namespace shade { namespace io {
 	struct http;
 } }
@@ -49,24 +49,41 @@ namespace shade { namespace model {
 
 #undef MEM_EQ
 
+	// Position of each source in its vector, by id
+	using source_index = std::unordered_map<atom, size_t>;
+
+	struct sources_translator;
 	class bridge : public std::enable_shared_from_this<bridge> {
+		friend struct sources_translator;
+
 		bool seen_ = false;
 		std::string id_;
 		hw_info hw_;
 		vector_shared<light> lights_;
 		vector_shared<group> groups_;
+		source_index light_index_;
+		source_index group_index_;
+		std::shared_ptr<arena> arena_ = std::make_shared<arena>();
+		std::shared_ptr<state_table> light_states_ = std::make_shared<state_table>();
+		std::shared_ptr<state_table> group_states_ = std::make_shared<state_table>();
+		std::shared_ptr<const json::map> stored_; // lights and groups as read from storage, until hydrated
 		std::shared_ptr<model::host> current_;
 		vector_shared<model::host> hosts_;
 		io::http* browser_ = nullptr;
+		std::shared_ptr<atom_table> atoms_;
+		mutable std::shared_ptr<const io::endpoint> endpoint_;
+		mutable io::connection logged_;
+		mutable std::string logged_as_;
+		std::unordered_map<atom, pending_change> pending_;
 
 	public:
 		bridge() = default;
-		bridge(const std::string& id, io::http* browser);
+		bridge(const std::string& id, io::http* browser, std::shared_ptr<atom_table> atoms);
 		bridge(const bridge&) = delete;
 		bridge& operator=(const bridge&) = delete;
 		bridge(bridge&&) = default;
 		bridge& operator=(bridge&&) = delete;
-		void from_storage(const std::string& id, io::http* browser);
+		void from_storage(const std::string& id, io::http* browser, std::shared_ptr<atom_table> atoms);
 
 		static void prepare(json::struct_translator&);
 
@@ -74,23 +91,40 @@ namespace shade { namespace model {
 		model::host& host() const { return *current_; }
 
 		std::string id() const { return id_; }
+		atom_table& atoms() const { return *atoms_; }
 		bool seen() const { return seen_; }
 		void seen(bool v) { seen_ = v; }
 		const hw_info& hw() const { return hw_; }
 		void hw(hw_info v) { hw_ = std::move(v); }
 		void set_base(std::string base) { hw_.base = std::move(base); }
 		const vector_shared<light>& lights() const { return lights_; }
-		void lights(vector_shared<light> v) { lights_ = std::move(v); }
+		void lights(vector_shared<light> v) { hydrate(); lights_ = std::move(v); reindex(); }
 		const vector_shared<group>& groups() const { return groups_; }
-		void groups(vector_shared<group> v) { groups_ = std::move(v); }
-
-		io::connection logged(io::http* browser) const { return unlogged(browser).logged(host().username()); }
-		io::connection unlogged(io::http* browser) const { return { browser, hw_.base, id_ }; }
-
-		bool bridge_lights(
-			std::unordered_map<std::string, hue::light> lights,
-			std::unordered_map<std::string, hue::group> groups,
-			listener::bridge* listener);
+		void groups(vector_shared<group> v) { hydrate(); groups_ = std::move(v); reindex(); }
+		const state_table& light_states() const { return *light_states_; }
+		const state_table& group_states() const { return *group_states_; }
+
+		// Lights and groups of a bridge read from the storage are kept
+		// as JSON until first needed; until then the getters above are
+		// empty. Goes through cache::hydrate, under the cache lock.
+		bool hydrated() const { return !stored_; }
+		void hydrate();
+
+		const std::shared_ptr<const io::endpoint>& endpoint() const;
+		const io::connection& logged(io::http* browser) const;
+		io::connection unlogged(io::http* browser) const { return { browser, endpoint(), id_ }; }
+
+		bridge_snapshot snapshot() const;
+		bool apply(bridge_diff& diff, change_set& changes);
+
+		// Optimistic updates: pend() applies the patches right away and
+		// remembers them under the request; until settle() hears back,
+		// reconcile() keeps the heartbeat from undoing them. Only the
+		// rejected fields are rolled back.
+		bool pend(std::uint64_t request, const patch_list& targets, change_set& changes);
+		bool settle(std::uint64_t request, const std::vector<atom>& ids, std::uint32_t rejected, change_set& changes);
+		void reconcile(bridge_diff& diff);
+		bool pending() const { return !pending_.empty(); }
 
 		void seen(std::string name, std::string mac, std::string modelid)
 		{
@@ -101,10 +135,11 @@ namespace shade { namespace model {
 		}
 
 	private:
+		void reindex();
 		void connect(std::chrono::nanoseconds sofar);
 		void getuser(int status, json::value doc, std::chrono::nanoseconds sofar, std::chrono::steady_clock::time_point then);
 
-		bool update_lights(std::unordered_map<std::string, hue::light> lights, listener::bridge* listener);
-		bool update_groups(std::unordered_map<std::string, hue::group> groups, listener::bridge* listener);
+		bool apply_lights(bridge_diff& diff, change_set& changes);
+		bool apply_groups(bridge_diff& diff, change_set& changes);
 	};
 } }
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <shade/model/diff.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace shade { namespace model {
+	class bridge;
+	class light_source;
+	struct bridge_state;
+
+	enum source_field : std::uint32_t {
+		field_index  = 1 << 0,
+		field_id     = 1 << 1,
+		field_name   = 1 << 2,
+		field_type   = 1 << 3,
+		field_on     = 1 << 4,
+		field_bri    = 1 << 5,
+		field_value  = 1 << 6,
+		field_klass  = 1 << 7,
+		field_some   = 1 << 8,
+		field_lights = 1 << 9,
+	};
+
+	std::uint32_t changed_fields(const source_values& before, const source_values& after);
+
+	struct source_change {
+		enum kind_t {
+			added,
+			removed,
+			changed
+		};
+
+		kind_t kind = changed;
+		std::uint32_t fields = 0; // source_field bits; all of them for added and removed
+		source_values before;     // empty for added
+		source_values after;      // empty for removed
+		std::shared_ptr<light_source> source;
+	};
+
+	// Everything a single update did to a bridge. The sequence grows with
+	// every change set produced by the cache and matches the version of
+	// the snapshot the changes were first published in. Changes to the
+	// bridge itself (found, moved, renamed, paired or hydrated) carry the
+	// state it was published with instead.
+	struct change_set {
+		std::uint64_t sequence = 0;
+		std::shared_ptr<model::bridge> bridge;
+		std::vector<source_change> changes;
+		std::shared_ptr<const bridge_state> state;
+
+		bool empty() const { return changes.empty(); }
+		void added(const std::shared_ptr<light_source>& source, source_values after);
+		void removed(const std::shared_ptr<light_source>& source, source_values before);
+		void changed(const std::shared_ptr<light_source>& source, source_values before, source_values after);
+	};
+} }
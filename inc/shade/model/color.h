@@ -0,0 +1,103 @@
+#pragma once
+
+#include <utility>
+
+namespace shade { namespace hue {
+	struct light_state;
+} }
+
+namespace shade { namespace model {
+	namespace mode {
+		enum : int { max_value = 254 };
+		struct hue_sat {
+			int hue;
+			int sat;
+		};
+
+		struct ct {
+			int val;
+		};
+
+		struct xy {
+			double x;
+			double y;
+		};
+
+		enum class mode {
+			empty,
+			hue_sat,
+			ct,
+			xy
+		};
+
+		class color {
+			mode mode_ = mode::empty;
+			union {
+				hue_sat hue_;
+				ct ct_;
+				xy xy_;
+			};
+		public:
+			color();
+			color(const color&);
+			color(color&&);
+			color& operator=(const color&);
+			color& operator=(color&&);
+
+			color(const hue_sat&);
+			color(hue_sat&&);
+			color(const ct&);
+			color(ct&&);
+			color(const xy&);
+			color(xy&&);
+			bool operator == (const color&) const;
+			bool operator != (const color& rhs) const {
+				return !(*this == rhs);
+			}
+
+			template<class Visitor>
+			void visit(Visitor visitor) const {
+				switch (mode_) {
+				case mode::empty: break;
+				case mode::hue_sat: visitor(hue_); break;
+				case mode::ct: visitor(ct_); break;
+				case mode::xy: visitor(xy_); break;
+				}
+			}
+
+			template<class Visitor>
+			void visit(Visitor visitor) {
+				switch (mode_) {
+				case mode::empty: break;
+				case mode::hue_sat: visitor(hue_); break;
+				case mode::ct: visitor(ct_); break;
+				case mode::xy: visitor(xy_); break;
+				}
+			}
+
+			static color from_json(const hue::light_state& state);
+		};
+
+		inline int clamp(int v) { return v < 0 ? 0 : v > max_value ? max_value : v; }
+
+		template <typename ... L> struct combine_t;
+
+		template <typename L> struct combine_t<L> : L {
+			combine_t(L lambda) : L{ std::move(lambda) } {}
+			using L::operator();
+		};
+
+		template <typename L1, typename L2, typename ... Ln>
+		struct combine_t<L1, L2, Ln...> : L1, combine_t<L2, Ln...> {
+			combine_t(L1 l1, L2 l2, Ln ... l) : L1{ std::move(l1) }, combine_t<L2, Ln...>{ std::move(l2), std::move(l)... } {}
+			using L1::operator();
+			using combine_t<L2, Ln...>::operator();
+		};
+
+		template <typename ... L> 
+		combine_t<L...> combine(L... l) {
+			return { std::move(l)... };
+		}
+	}
+	using color_mode = mode::color;
+} }
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <shade/model/atom.h>
+#include <shade/model/color.h>
+#include <string>
+#include <vector>
+
+namespace shade { namespace hue {
+	struct sources;
+} }
+
+namespace shade { namespace model {
+	// Values of a light or a group, detached from the bridge, so they can
+	// be compared away from the bridge's strand.
+	struct source_values {
+		atom index;
+		atom id;
+		std::string name;
+		atom type;
+		bool on = false;
+		int bri = 0;
+		color_mode value;
+
+		// groups only
+		std::string klass;
+		bool some = false;
+		std::vector<atom> lights;
+
+		bool operator == (const source_values&) const;
+		bool operator != (const source_values& rhs) const { return !(*this == rhs); }
+	};
+
+	struct bridge_snapshot {
+		std::vector<source_values> lights;
+		std::vector<source_values> groups;
+	};
+
+	struct bridge_diff {
+		std::vector<source_values> added_lights;
+		std::vector<source_values> changed_lights;
+		std::vector<atom> removed_lights;
+		std::vector<source_values> added_groups;
+		std::vector<source_values> changed_groups;
+		std::vector<atom> removed_groups;
+
+		bool empty() const;
+	};
+
+	// Group members are compared regardless of their order
+	bool same_lights(const std::vector<atom>& lhs, const std::vector<atom>& rhs);
+	bridge_diff compute_diff(const bridge_snapshot& current, hue::sources& incoming, atom_table& atoms);
+} }
@@ -3,10 +3,6 @@
 #include <shade/model/light.h>
 #include <memory>
 
-namespace shade { namespace hue {
-	struct group;
-} }
-
 namespace shade { namespace model {
 	class group : public light_source, public std::enable_shared_from_this<group> {
 		bool some_;
@@ -14,8 +10,8 @@ namespace shade { namespace model {
 		vector_shared<light> lights_;
 	public:
 		group() = default;
-		group(const std::shared_ptr<model::bridge>& owner, std::string idx, std::string id, std::string name, std::string type, std::string klass, bool on, bool some, int bri, color_mode value, vector_shared<light> lights)
-			: light_source{ owner, std::move(idx), std::move(id), std::move(name), std::move(type), on, bri, std::move(value) }
+		group(const std::shared_ptr<model::bridge>& owner, std::shared_ptr<state_table> states, atom idx, atom id, std::string name, atom type, std::string klass, bool on, bool some, int bri, color_mode value, vector_shared<light> lights)
+			: light_source{ owner, std::move(states), idx, id, std::move(name), type, on, bri, std::move(value) }
 			, some_{ some }
 			, klass_{ std::move(klass) }
 			, lights_ { std::move(lights) }
@@ -29,14 +25,15 @@ namespace shade { namespace model {
 		void lights(vector_shared<light> v) { lights_ = std::move(v); }
 		bool is_group() const override { return true; }
 		bool operator == (const group&) const;
-		bool update(const std::string& key, hue::group json, const vector_shared<light>& resource);
+		source_values values() const;
+		bool update(const source_values& values, const vector_shared<light>& resource);
 
-		static auto make(const std::shared_ptr<model::bridge>& owner, std::string idx, std::string id, std::string name, std::string type, std::string klass, bool on, bool some, int bri, color_mode value, vector_shared<light> lights) {
-			return std::make_shared<group>(owner, std::move(idx), std::move(id), std::move(name), std::move(type), std::move(klass), on, some, bri, std::move(value), std::move(lights));
+		static auto make(const std::shared_ptr<arena>& pool, const std::shared_ptr<model::bridge>& owner, std::shared_ptr<state_table> states, atom idx, atom id, std::string name, atom type, std::string klass, bool on, bool some, int bri, color_mode value, vector_shared<light> lights) {
+			return model::allocate_shared<group>(pool, owner, std::move(states), idx, id, std::move(name), type, std::move(klass), on, some, bri, std::move(value), std::move(lights));
 		}
 
 		static void prepare(json::struct_translator& tr);
-		static vector_shared<light> referenced(const std::vector<std::string>& refs, const vector_shared<light>& resource);
+		static vector_shared<light> referenced(const std::vector<atom>& refs, const vector_shared<light>& resource);
 	};
 
 	inline bool operator!= (const group& lhs, const group& rhs) {
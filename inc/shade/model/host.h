@@ -1,4 +1,5 @@
 #pragma once
+#include <shade/model/atom.h>
 #include <string>
 #include <unordered_set>
 
@@ -14,7 +15,7 @@ namespace shade { namespace model {
 	class host {
 		std::string name_;
 		std::string username_;
-		std::unordered_set<std::string> selected_;
+		std::unordered_set<atom> selected_;
 	public:
 		host() = default;
 		host(const std::string& name) : name_{ name } {}
@@ -24,12 +25,12 @@ namespace shade { namespace model {
 		const std::string& name() const { return name_; }
 		const std::string& username() const { return username_; }
 		auto const& selected() const { return selected_; }
-		void batch_update(const std::unordered_set<std::string>& upstream) {
+		void batch_update(const std::unordered_set<atom>& upstream) {
 			selected_ = upstream;
 		}
 
 		bool update(const std::string& user);
-		bool is_selected(const std::string& dev) const;
-		void switch_selection(const std::string& dev);
+		bool is_selected(atom dev) const;
+		void switch_selection(atom dev);
 	};
 } }
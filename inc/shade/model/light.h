@@ -3,19 +3,14 @@
 #include <shade/model/light_source.h>
 #include <memory>
 
-namespace shade { namespace hue {
-	struct light;
-} }
-
 namespace shade { namespace model {
 	class light : public light_source, public std::enable_shared_from_this<light> {
 	public:
 		using light_source::light_source;
 		bool operator == (const light&) const;
-		bool update(const std::string& key, hue::light json);
 
-		static auto make(const std::shared_ptr<model::bridge>& owner, std::string idx, std::string id, std::string name, std::string type, bool on, int bri, color_mode value) {
-			return std::make_shared<light>(owner, std::move(idx), std::move(id), std::move(name), std::move(type), on, bri, std::move(value));
+		static auto make(const std::shared_ptr<arena>& pool, const std::shared_ptr<model::bridge>& owner, std::shared_ptr<state_table> states, atom idx, atom id, std::string name, atom type, bool on, int bri, color_mode value) {
+			return model::allocate_shared<light>(pool, owner, std::move(states), idx, id, std::move(name), type, on, bri, std::move(value));
 		}
 
 		static void prepare(json::struct_translator& tr)
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <shade/model/change_set.h>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace shade { namespace model {
+	class light_source;
+
+	// What a command sets on a source; fields holds field_on, field_bri
+	// and field_value bits only.
+	struct source_patch {
+		std::uint32_t fields = 0;
+		bool on = false;
+		int bri = 0;
+		color_mode value;
+
+		void apply(source_values& values) const;
+		void take(const source_values& values, std::uint32_t fields);
+	};
+
+	using patch_list = std::vector<std::pair<std::shared_ptr<light_source>, source_patch>>;
+
+	// A source changed ahead of the bridge's answer; only the patched
+	// fields are kept. The values before are the last ones the bridge
+	// confirmed, kept across newer requests.
+	struct pending_change {
+		std::uint64_t request = 0;
+		source_patch before;
+		source_patch expected;
+	};
+} }
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <shade/model/group.h>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace shade { namespace model {
+	// How many commands of each kind a bridge takes in one window,
+	// before it starts dropping them.
+	struct rate_budget {
+		size_t lights = 10;
+		size_t groups = 1;
+		std::chrono::milliseconds window{ 1000 };
+	};
+
+	// The state is an index into the caller's list of distinct states.
+	struct plan_target {
+		std::shared_ptr<model::light> source;
+		size_t state;
+	};
+
+	struct planned_command {
+		std::shared_ptr<light_source> source; // a light or a group
+		size_t state;
+	};
+
+	// Lights sharing a state are covered by the groups made only of such
+	// lights, for as long as that shortens the number of windows needed
+	// to send everything (or keeps it and sends fewer requests); the rest
+	// is sent light by light.
+	std::vector<planned_command> plan_commands(const std::vector<plan_target>& targets, const vector_shared<group>& groups, const rate_budget& budget = {});
+} }
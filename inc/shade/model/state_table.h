@@ -0,0 +1,55 @@
+#pragma once
+
+#include <shade/model/color.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace shade { namespace model {
+	// Column-wise storage for the state of all light sources of one kind
+	// on one bridge. Light sources keep a handle to their row; released
+	// rows are reused by later acquire() calls, so handles stay stable
+	// for as long as the source is alive.
+	class state_table {
+	public:
+		using handle = uint32_t;
+
+		handle acquire();
+		void release(handle row);
+
+		size_t size() const { return used_.size(); }
+		bool used(handle row) const { return !!used_[row]; }
+
+		bool on(handle row) const { return !!on_[row]; }
+		void on(handle row, bool v) { on_[row] = v; }
+		int bri(handle row) const { return bri_[row]; }
+		void bri(handle row, int v) { bri_[row] = (uint8_t)mode::clamp(v); }
+		mode::color value(handle row) const;
+		void value(handle row, const mode::color& v);
+
+		void copy(handle row, const state_table& src, handle src_row);
+
+		const std::vector<uint8_t>& used_column() const { return used_; }
+		const std::vector<uint8_t>& on_column() const { return on_; }
+		const std::vector<uint8_t>& bri_column() const { return bri_; }
+		const std::vector<mode::mode>& mode_column() const { return mode_; }
+		const std::vector<int>& hue_column() const { return hue_; }
+		const std::vector<int>& sat_column() const { return sat_; }
+		const std::vector<int>& ct_column() const { return ct_; }
+		const std::vector<double>& x_column() const { return x_; }
+		const std::vector<double>& y_column() const { return y_; }
+
+		size_t count_on() const;
+	private:
+		std::vector<uint8_t> used_;
+		std::vector<uint8_t> on_;
+		std::vector<uint8_t> bri_;
+		std::vector<mode::mode> mode_;
+		std::vector<int> hue_;
+		std::vector<int> sat_;
+		std::vector<int> ct_;
+		std::vector<double> x_;
+		std::vector<double> y_;
+		std::vector<handle> free_;
+	};
+} }
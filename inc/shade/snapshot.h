@@ -0,0 +1,44 @@
+#pragma once
+
+#include <shade/model/bridge.h>
+#include <shade/model/diff.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace shade {
+	namespace model {
+		// Frozen copy of a bridge. Once published it never changes, so it
+		// can be read from any thread for as long as the reader holds it.
+		struct bridge_state {
+			std::uint64_t version = 0;
+			std::string id;
+			hw_info hw;
+			bool seen = false;
+			std::string username;
+			bool hydrated = false; // no lights or groups until the bridge is hydrated
+			std::vector<source_values> lights;
+			std::vector<source_values> groups;
+
+			static std::shared_ptr<const bridge_state> make(const bridge& from, std::uint64_t version);
+		};
+	}
+
+	// One version of the whole cache. Bridges untouched between versions
+	// share their state with the previous version.
+	struct cache_snapshot {
+		using bridges_t = std::unordered_map<std::string, std::shared_ptr<const model::bridge_state>>;
+
+		std::uint64_t version = 0;
+		bridges_t bridges;
+
+		std::shared_ptr<const model::bridge_state> get(const std::string& id) const
+		{
+			auto it = bridges.find(id);
+			if (it != bridges.end())
+				return it->second;
+			return {};
+		}
+	};
+}
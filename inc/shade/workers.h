@@ -0,0 +1,31 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace shade {
+	// A small pool for CPU-bound work taken off the network threads. The
+	// queue is bounded; submit() refuses new jobs instead of letting a
+	// slow pool pile them up.
+	class workers {
+		std::mutex lock_;
+		std::condition_variable wake_;
+		std::deque<std::function<void()>> jobs_;
+		std::vector<std::thread> threads_;
+		size_t capacity_;
+		bool done_ = false;
+
+		void run();
+	public:
+		explicit workers(size_t threads = std::thread::hardware_concurrency(), size_t capacity = 256);
+		~workers();
+		workers(const workers&) = delete;
+		workers& operator=(const workers&) = delete;
+
+		bool submit(std::function<void()> job);
+	};
+}
@@ -1,12 +1,17 @@
 #include <shade/asio/http.h>
+#include <array>
 
 namespace shade { namespace io { namespace asio {
+	template <typename Protocol>
 	class http_handler : public http::handler {
+		using socket_type = typename Protocol::socket;
+		using endpoint_type = typename Protocol::endpoint;
+
 		io_service& service_;
-		ip::tcp::resolver resolver_;
-		ip::tcp::socket socket_;
+		socket_type socket_;
 		streambuf request_;
 		streambuf response_;
+		std::array<char, 4096> chunk_;
 		http::listener_ptr client_;
 
 		void error(const error_code& ec) {
@@ -18,7 +23,6 @@ namespace shade { namespace io { namespace asio {
 			client_->on_data(nullptr, 0);
 		}
 
-		void connect(ip::tcp::resolver::iterator endpoints);
 		void write_request();
 		void read_headers();
 		void read_body();
@@ -26,7 +30,6 @@ namespace shade { namespace io { namespace asio {
 
 		http_handler(io_service& service, http::listener_ptr listener)
 			: service_{ service }
-			, resolver_{ service }
 			, socket_{ service }
 			, client_{ std::move(listener) }
 		{}
@@ -35,69 +38,162 @@ namespace shade { namespace io { namespace asio {
 		http::listener* listener() { return client_.get(); }
 
 		void send(const std::string& host, const std::string& service);
+		void connect(const endpoint_type& endpoint);
+		void connect(ip::tcp::resolver::iterator endpoints);
 	};
 
+	using tcp_handler = http_handler<ip::tcp>;
+
 	static inline bool error(http::listener* listener, int status = 1000) {
 		listener->on_headers(status, {}, {});
 		listener->on_data(nullptr, 0);
 		return false;
 	}
 
+	static inline void write(std::streambuf* buffer, const tangle::cstring& value)
+	{
+		buffer->sputn(value.data(), value.length());
+	}
+
 	bool http::send(method method, const tangle::uri& address, const std::string& data, listener_ptr listener)
 	{
-		auto handler = std::make_unique<http_handler>(service_, std::move(listener));
-		auto content_type = handler->listener()->content_type();
+		auto auth = tangle::uri::auth_builder::parse(address.authority());
+
+		auto host_field = "Host: " + auth.host;
+		if (!auth.port.empty())
+			host_field += ":" + auth.port;
+		host_field += "\r\n";
+
+		auto service = auth.port.empty() ? address.scheme().str() : auth.port;
+		return send(method, auth.host, service, host_field, address.path(), address.query(), data, std::move(listener));
+	}
+
+	bool http::send(method method, const endpoint& where, const std::string& root, const std::string& resource, const std::string& data, listener_ptr listener)
+	{
+		return send(method, where.host(), where.service(), where.host_field(), root, resource, data, std::move(listener));
+	}
+
+	template <typename Handler>
+	bool http::prepare(Handler& handler, method method, const std::string& host_field,
+		const tangle::cstring& root, const tangle::cstring& resource, const std::string& data)
+	{
+		auto content_type = handler.listener()->content_type();
 		switch (method) {
 		case method::PUT:
 		case method::POST:
 			if (content_type.empty() || data.empty())
-				return error(handler->listener());
+				return error(handler.listener());
 			break;
 		default:
 			if (!data.empty())
-				return error(handler->listener());
+				return error(handler.listener());
 		}
 
-		auto auth = tangle::uri::auth_builder::parse(address.authority());
-
-		std::ostream os(handler->buffer());
+		auto buffer = handler.buffer();
 		switch (method) {
-		case method::GET:  os << "GET "; break;
-		case method::DEL:  os << "DELETE "; break;
-		case method::PUT:  os << "PUT "; break;
-		case method::POST: os << "POST "; break;
+		case method::GET:  write(buffer, "GET "); break;
+		case method::DEL:  write(buffer, "DELETE "); break;
+		case method::PUT:  write(buffer, "PUT "); break;
+		case method::POST: write(buffer, "POST "); break;
 		}
-		os << address.path() << address.query() << " HTTP/1.0\r\n";
-		os << "Host: " << auth.host;
-		if (!auth.port.empty())
-			os << ":" << auth.port;
-		os << "\r\n";
-		os << "Accept: */*\r\n";
+		write(buffer, root);
+		write(buffer, resource);
+		write(buffer, " HTTP/1.0\r\n");
+		write(buffer, host_field);
+		write(buffer, "Accept: */*\r\n");
 		if (!data.empty()) {
-			os << "Content-Type: " << content_type << "\r\n";
-			os << "Content-Length: " << data.length() << "\r\n";
+			write(buffer, "Content-Type: ");
+			write(buffer, content_type);
+			write(buffer, "\r\nContent-Length: ");
+			write(buffer, std::to_string(data.length()));
+			write(buffer, "\r\n");
 		}
-		os << "Connection: close\r\n\r\n";
-		os << data;
+		write(buffer, "Connection: close\r\n\r\n");
+		write(buffer, data);
+		return true;
+	}
+
+	bool http::send(method method, const std::string& host, const std::string& service, const std::string& host_field,
+		const tangle::cstring& root, const tangle::cstring& resource, const std::string& data, listener_ptr listener)
+	{
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+		// the same request goes to the local daemon, which tells the
+		// bridges apart by the Host field
+		if (!local_.empty()) {
+			auto handler = std::make_unique<http_handler<local::stream_protocol>>(service_, std::move(listener));
+			if (!prepare(*handler, method, host_field, root, resource, data))
+				return false;
+
+			auto ptr = handler.get();
+			ptr->listener()->set_handler(std::move(handler));
+			ptr->connect(local::stream_protocol::endpoint{ local_ });
+			return true;
+		}
+#endif
+
+		auto handler = std::make_unique<tcp_handler>(service_, std::move(listener));
+		if (!prepare(*handler, method, host_field, root, resource, data))
+			return false;
 
-		auto service = auth.port.empty() ? address.scheme().str() : auth.port;
 		auto ptr = handler.get();
 		ptr->listener()->set_handler(std::move(handler));
-		ptr->send(auth.host, service);
+		ptr->send(host, service);
+		return true;
+	}
+
+	static inline bool numeric_port(const std::string& service, unsigned short& port)
+	{
+		if (service == "http") {
+			port = 80;
+			return true;
+		}
+
+		if (service.empty() || service.length() > 5)
+			return false;
+
+		unsigned value = 0;
+		for (auto c : service) {
+			if (c < '0' || c > '9')
+				return false;
+			value = value * 10 + (c - '0');
+		}
+		if (value > 65535)
+			return false;
+		port = (unsigned short)value;
 		return true;
 	}
 
-	void http_handler::send(const std::string& host, const std::string& service)
+	template <typename Protocol>
+	void http_handler<Protocol>::send(const std::string& host, const std::string& service)
 	{
+		// bridges are addressed by IP, there is nothing to resolve
+		error_code ec;
+		unsigned short port = 0;
+		auto address = ip::address::from_string(host, ec);
+		if (!ec && numeric_port(service, port))
+			return connect(ip::tcp::endpoint{ address, port });
+
+		auto resolver = std::make_shared<ip::tcp::resolver>(service_);
 		ip::tcp::resolver::query query{ host, service };
-		resolver_.async_resolve(query, [this](const error_code& ec, ip::tcp::resolver::iterator endpoints) {
+		resolver->async_resolve(query, [this, resolver](const error_code& ec, ip::tcp::resolver::iterator endpoints) {
 			if (ec)
 				return error(ec);
 			connect(endpoints);
 		});
 	}
 
-	void http_handler::connect(ip::tcp::resolver::iterator endpoints)
+	template <typename Protocol>
+	void http_handler<Protocol>::connect(const endpoint_type& endpoint)
+	{
+		socket_.async_connect(endpoint, [this](const error_code& ec) {
+			if (ec)
+				return error(ec);
+			write_request();
+		});
+	}
+
+	template <typename Protocol>
+	void http_handler<Protocol>::connect(ip::tcp::resolver::iterator endpoints)
 	{
 		async_connect(socket_, endpoints, [this](const error_code& ec, ip::tcp::resolver::iterator iterator) {
 			if (ec)
@@ -106,7 +202,8 @@ namespace shade { namespace io { namespace asio {
 		});
 	}
 
-	void http_handler::write_request()
+	template <typename Protocol>
+	void http_handler<Protocol>::write_request()
 	{
 		async_write(socket_, request_, [this](const error_code& ec, size_t written) {
 			if (ec)
@@ -115,7 +212,8 @@ namespace shade { namespace io { namespace asio {
 		});
 	}
 
-	void http_handler::read_headers()
+	template <typename Protocol>
+	void http_handler<Protocol>::read_headers()
 	{
 		async_read_until(socket_, response_, "\r\n\r\n", [this](const error_code& ec, size_t read) {
 			if (ec)
@@ -125,18 +223,17 @@ namespace shade { namespace io { namespace asio {
 			auto ptr = buffer_cast<const char*>(data);
 
 			using namespace tangle::msg;
-			http_response parser{};
-			auto result = parser.append(ptr, read);
+			http_response_view parser{};
+			auto result = parser.parse(ptr, read);
 			if (std::get<parsing>(result) != parsing::separator) {
 				socket_.close();
 				return error();
 			}
 
+			// the headers point into the buffer, consume it only after use
+			client_->on_headers(parser.status(), parser.reason(), parser.dict());
 			response_.consume(std::get<size_t>(result) + 2);
 
-			auto headers = parser.dict();
-			client_->on_headers(parser.status(), parser.reason(), headers);
-
 			if (response_.size() > 0) {
 				auto data = response_.data();
 				auto size = buffer_size(data);
@@ -151,19 +248,15 @@ namespace shade { namespace io { namespace asio {
 		});
 	}
 
-	void http_handler::read_body()
+	template <typename Protocol>
+	void http_handler<Protocol>::read_body()
 	{
-		async_read(socket_, response_, transfer_at_least(1), [this](const error_code& ec, size_t read) {
+		socket_.async_read_some(boost::asio::buffer(chunk_), [this](const error_code& ec, size_t read) {
 			if (ec)
 				return client_->on_data(nullptr, 0);
 
-			auto data = response_.data();
-			auto size = buffer_size(data);
-			auto ptr = buffer_cast<const char*>(data);
-			if (size) {
-				client_->on_data(ptr, size);
-				response_.consume(size);
-			}
+			if (read)
+				client_->on_data(chunk_.data(), read);
 
 			read_body();
 		});
@@ -9,6 +9,10 @@ namespace shade { namespace io { namespace asio {
 	public:
 		udp(io_service&, error_code&);
 		bool bind(uint16_t) override;
+		bool bind(uint32_t local, uint16_t port) override;
+		bool multicast_interface(uint32_t local) override;
+		bool reuse_address() override;
+		bool join_group(uint32_t group, uint32_t local) override;
 		bool write_datagram(const uint8_t* data, size_t length, uint32_t ip, uint16_t port) override;
 		std::unique_ptr<io::read_handler> read_datagram(std::chrono::milliseconds duration, std::function<void(const uint8_t*, size_t, bool)> && cb) override;
 	};
@@ -27,6 +31,34 @@ namespace shade { namespace io { namespace asio {
 		return !ec;
 	}
 
+	bool udp::bind(uint32_t local, uint16_t port)
+	{
+		error_code ec;
+		socket_.bind(ip::udp::endpoint{ ip::address_v4{ local }, port }, ec);
+		return !ec;
+	}
+
+	bool udp::multicast_interface(uint32_t local)
+	{
+		error_code ec;
+		socket_.set_option(ip::multicast::outbound_interface{ ip::address_v4{ local } }, ec);
+		return !ec;
+	}
+
+	bool udp::reuse_address()
+	{
+		error_code ec;
+		socket_.set_option(socket_base::reuse_address{ true }, ec);
+		return !ec;
+	}
+
+	bool udp::join_group(uint32_t group, uint32_t local)
+	{
+		error_code ec;
+		socket_.set_option(ip::multicast::join_group{ ip::address_v4{ group }, ip::address_v4{ local } }, ec);
+		return !ec;
+	}
+
 	bool udp::write_datagram(const uint8_t* data, size_t length, uint32_t ip, uint16_t port)
 	{
 		error_code ec;
@@ -74,6 +106,12 @@ namespace shade { namespace io { namespace asio {
 		void start(std::chrono::milliseconds ms, error_code& ec)
 		{
 			auto self = shared_from_this();
+			if (!ms.count()) {
+				active_ = true;
+				async_read();
+				return;
+			}
+
 			timer_.expires_from_now(boost::posix_time::milliseconds{ ms.count() }, ec);
 			if (ec) return;
 			active_ = true;
@@ -141,10 +179,12 @@ namespace shade { namespace io { namespace asio {
 
 	class timer : public std::enable_shared_from_this<timer> {
 		deadline_timer timer_;
+		io_service::strand* strand_;
 		std::function<void()> cb_;
 	public:
-		timer(io_service& service, std::function<void()> && cb)
+		timer(io_service& service, io_service::strand* strand, std::function<void()> && cb)
 			: timer_{ service }
+			, strand_{ strand }
 			, cb_{ std::move(cb) }
 		{}
 
@@ -156,11 +196,16 @@ namespace shade { namespace io { namespace asio {
 				return false;
 
 			auto self = shared_from_this();
-			timer_.async_wait([self, this](const error_code& ec) {
+			auto handler = [self, this](const error_code& ec) {
 				if (ec)
 					return;
 				cb_();
-			});
+			};
+
+			if (strand_)
+				timer_.async_wait(strand_->wrap(handler));
+			else
+				timer_.async_wait(handler);
 
 			return true;
 		}
@@ -183,12 +228,42 @@ namespace shade { namespace io { namespace asio {
 		}
 	};
 
-	std::unique_ptr<io::timeout> network::timeout(milliseconds duration, std::function<void()> && cb)
+	static std::unique_ptr<io::timeout> make_timeout(io_service& service, io_service::strand* strand, milliseconds duration, std::function<void()> && cb)
 	{
-		auto timer = std::make_shared<asio::timer>(service_, std::move(cb));
+		auto timer = std::make_shared<asio::timer>(service, strand, std::move(cb));
 		auto result = std::make_unique<timeout_handler>(timer);
 		if (!timer->start(duration))
 			return {};
 		return result;
 	}
+
+	std::unique_ptr<io::timeout> network::timeout(milliseconds duration, std::function<void()> && cb)
+	{
+		return make_timeout(service_, nullptr, duration, std::move(cb));
+	}
+
+	class strand : public io::strand {
+		io_service& service_;
+		io_service::strand strand_;
+	public:
+		strand(io_service& service)
+			: service_{ service }
+			, strand_{ service }
+		{}
+
+		void post(std::function<void()> && cb) override
+		{
+			strand_.post(std::move(cb));
+		}
+
+		std::unique_ptr<io::timeout> timeout(milliseconds duration, std::function<void()> && cb) override
+		{
+			return make_timeout(service_, &strand_, duration, std::move(cb));
+		}
+	};
+
+	std::unique_ptr<io::strand> network::make_strand()
+	{
+		return std::make_unique<strand>(service_);
+	}
 } } }
@@ -0,0 +1,31 @@
+#include <shade/asio/network.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <algorithm>
+
+namespace shade { namespace io { namespace asio {
+	std::vector<uint32_t> network::interfaces()
+	{
+		std::vector<uint32_t> out;
+
+		ifaddrs* list = nullptr;
+		if (getifaddrs(&list))
+			return out;
+
+		for (auto it = list; it; it = it->ifa_next) {
+			if (!it->ifa_addr || it->ifa_addr->sa_family != AF_INET)
+				continue;
+			if (!(it->ifa_flags & IFF_UP) || (it->ifa_flags & IFF_LOOPBACK) || !(it->ifa_flags & IFF_MULTICAST))
+				continue;
+
+			auto addr = ntohl(reinterpret_cast<const sockaddr_in*>(it->ifa_addr)->sin_addr.s_addr);
+			if (std::find(out.begin(), out.end(), addr) == out.end())
+				out.push_back(addr);
+		}
+
+		freeifaddrs(list);
+		return out;
+	}
+} } }
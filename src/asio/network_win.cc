@@ -0,0 +1,43 @@
+#include <shade/asio/network.h>
+#include <winsock2.h>
+#include <iphlpapi.h>
+#include <algorithm>
+#include <vector>
+
+namespace shade { namespace io { namespace asio {
+	std::vector<uint32_t> network::interfaces()
+	{
+		std::vector<uint32_t> out;
+
+		ULONG size = 15 * 1024;
+		std::vector<char> buffer;
+		ULONG result = ERROR_BUFFER_OVERFLOW;
+		for (int tries = 0; result == ERROR_BUFFER_OVERFLOW && tries < 3; ++tries) {
+			buffer.resize(size);
+			result = GetAdaptersAddresses(AF_INET,
+				GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_DNS_SERVER,
+				nullptr, reinterpret_cast<IP_ADAPTER_ADDRESSES*>(buffer.data()), &size);
+		}
+		if (result != NO_ERROR)
+			return out;
+
+		for (auto it = reinterpret_cast<IP_ADAPTER_ADDRESSES*>(buffer.data()); it; it = it->Next) {
+			if (it->OperStatus != IfOperStatusUp || it->IfType == IF_TYPE_SOFTWARE_LOOPBACK)
+				continue;
+			if (it->Flags & IP_ADAPTER_NO_MULTICAST)
+				continue;
+
+			for (auto addr = it->FirstUnicastAddress; addr; addr = addr->Next) {
+				auto sa = addr->Address.lpSockaddr;
+				if (!sa || sa->sa_family != AF_INET)
+					continue;
+
+				auto ip = ntohl(reinterpret_cast<const sockaddr_in*>(sa)->sin_addr.s_addr);
+				if (std::find(out.begin(), out.end(), ip) == out.end())
+					out.push_back(ip);
+			}
+		}
+
+		return out;
+	}
+} } }
@@ -0,0 +1,16 @@
+#include <shade/asio/runner.h>
+
+namespace shade { namespace io { namespace asio {
+	void runner::run()
+	{
+		std::vector<std::thread> pool;
+		pool.reserve(threads_ - 1);
+		for (size_t i = 1; i < threads_; ++i)
+			pool.emplace_back([this] { service_.run(); });
+
+		service_.run();
+
+		for (auto& thread : pool)
+			thread.join();
+	}
+} } }
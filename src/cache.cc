@@ -9,17 +9,111 @@ namespace json {
 }
 
 namespace shade {
+	namespace model {
+		std::shared_ptr<const bridge_state> bridge_state::make(const bridge& from, std::uint64_t version)
+		{
+			auto out = std::make_shared<bridge_state>();
+			out->version = version;
+			out->id = from.id();
+			out->hw = from.hw();
+			out->seen = from.seen();
+			out->username = from.host().username();
+			out->hydrated = from.hydrated();
+			if (out->hydrated) {
+				auto sources = from.snapshot();
+				out->lights = std::move(sources.lights);
+				out->groups = std::move(sources.groups);
+			}
+			return out;
+		}
+	}
+
+	// Writers hold the lock, so the current snapshot can be read without
+	// atomic_load here; only the store has to be atomic.
+	std::uint64_t cache::publish(const std::shared_ptr<model::bridge>& bridge)
+	{
+		auto next = std::make_shared<cache_snapshot>(*snapshot_);
+		auto version = ++next->version;
+		next->bridges[bridge->id()] = model::bridge_state::make(*bridge, version);
+		std::atomic_store(&snapshot_, std::shared_ptr<const cache_snapshot>{ std::move(next) });
+		return version;
+	}
+
+	void cache::announce(const std::shared_ptr<model::bridge>& bridge)
+	{
+		auto set = std::make_shared<model::change_set>();
+		set->sequence = publish(bridge);
+		set->bridge = bridge;
+		set->state = snapshot_->get(bridge->id());
+		log_.push(std::move(set));
+	}
+
+	void cache::publish_all()
+	{
+		auto next = std::make_shared<cache_snapshot>();
+		next->version = snapshot_->version + 1;
+		next->bridges.reserve(known_bridges.size());
+		for (auto const& pair : known_bridges)
+			next->bridges[pair.first] = model::bridge_state::make(*pair.second, next->version);
+		log_.reset(next->version);
+		std::atomic_store(&snapshot_, std::shared_ptr<const cache_snapshot>{ std::move(next) });
+	}
+
+	// A fresh consumer, one that fell behind the log, or one that comes
+	// from a different run of the cache, gets the whole snapshot instead.
+	changes_since cache::changes(std::uint64_t since) const
+	{
+		changes_since out;
+		auto current = snapshot();
+		if (since && since <= current->version && log_.since(since, out.changes)) {
+			out.sequence = out.changes.empty() ? since : out.changes.back()->sequence;
+			return out;
+		}
+
+		out.changes.clear();
+		out.resync = true;
+		out.sequence = current->version;
+		out.snapshot = std::move(current);
+		return out;
+	}
+
+	void cache::bridges(const bridges_t& v)
+	{
+		auto lock = this->lock();
+		known_bridges = v;
+		publish_all();
+	}
+
+	void cache::bridges(bridges_t&& v)
+	{
+		auto lock = this->lock();
+		known_bridges = std::move(v);
+		publish_all();
+	}
+
+	void cache::hydrate(const std::shared_ptr<model::bridge>& bridge)
+	{
+		auto lock = this->lock();
+		if (bridge->hydrated())
+			return;
+		bridge->hydrate();
+		announce(bridge);
+	}
+
 	void cache::bridge_located(const std::string& id, const std::string& base, listener::storage* storage) {
+		auto lock = this->lock();
 		auto it = known_bridges.find(id);
 		if (it == known_bridges.end()) {
-			auto bridge = std::make_shared<model::bridge>(id, browser_);
+			auto bridge = std::make_shared<model::bridge>(id, browser_, atoms_);
 			bridge->set_host(clientid);
 			bridge->set_base(std::move(base));
+			announce(bridge);
 			known_bridges[id] = std::move(bridge);
 			storage->mark_dirty();
 		} else {
 			if (it->second->hw().base != base) {
 				it->second->set_base(std::move(base));
+				announce(it->second);
 				storage->mark_dirty();
 			}
 		}
@@ -29,41 +123,88 @@ namespace shade {
 		std::string name, std::string mac,
 		std::string modelid, listener::storage* storage)
 	{
+		auto lock = this->lock();
 		auto it = known_bridges.find(id);
 		if (it == known_bridges.end()) {
-			auto bridge = std::make_shared<model::bridge>(id, browser_);
+			auto bridge = std::make_shared<model::bridge>(id, browser_, atoms_);
 			bridge->set_host(clientid);
 			bridge->seen(std::move(name), std::move(mac), std::move(modelid));
+			announce(bridge);
 			known_bridges[id] = std::move(bridge);
 			storage->mark_dirty();
 		} else {
 			auto& bridge = it->second;
+			auto was_seen = bridge->seen();
 			bridge->seen(true);
 			if (bridge->hw().name != name
 				|| bridge->hw().mac != mac
 				|| bridge->hw().modelid != modelid) {
 				bridge->seen(std::move(name), std::move(mac), std::move(modelid));
+				announce(bridge);
 				storage->mark_dirty();
-			}
+			} else if (!was_seen)
+				announce(bridge);
 		}
 	}
 
 	void cache::bridge_connected(const std::shared_ptr<model::bridge>& bridge, const std::string& username, listener::storage* storage)
 	{
-		if (bridge->host().update(username))
+		auto lock = this->lock();
+		if (bridge->host().update(username)) {
+			announce(bridge);
 			storage->mark_dirty();
+		}
+	}
+
+	void cache::bridge_gone(const std::shared_ptr<model::bridge>& bridge)
+	{
+		auto lock = this->lock();
+		if (!bridge->seen())
+			return;
+		bridge->seen(false);
+		announce(bridge);
 	}
 
-	void cache::bridge_lights(const std::shared_ptr<model::bridge>& bridge,
-		std::unordered_map<std::string, hue::light> lights,
-		std::unordered_map<std::string, hue::group> groups,
+	void cache::deliver(const std::shared_ptr<model::bridge>& bridge, model::change_set& set,
 		listener::storage* storage, listener::bridge* changes)
 	{
-		auto l_size = lights.size();
-		auto g_size = groups.size();
-		if (bridge->bridge_lights(std::move(lights), std::move(groups), changes)) {
-			storage->mark_dirty();
-		}
+		set.sequence = publish(bridge);
+		storage->mark_dirty();
+		if (set.empty())
+			return;
+
+		auto logged = std::make_shared<const model::change_set>(std::move(set));
+		log_.push(logged);
+		if (changes)
+			changes->changed(*logged);
+	}
+
+	void cache::bridge_changed(const std::shared_ptr<model::bridge>& bridge, model::bridge_diff& diff,
+		listener::storage* storage, listener::bridge* changes)
+	{
+		auto lock = this->lock();
+		bridge->reconcile(diff);
+		model::change_set set;
+		if (bridge->apply(diff, set))
+			deliver(bridge, set, storage, changes);
+	}
+
+	void cache::bridge_pending(const std::shared_ptr<model::bridge>& bridge, std::uint64_t request, const model::patch_list& targets,
+		listener::storage* storage, listener::bridge* changes)
+	{
+		auto lock = this->lock();
+		model::change_set set;
+		if (bridge->pend(request, targets, set))
+			deliver(bridge, set, storage, changes);
+	}
+
+	void cache::bridge_settled(const std::shared_ptr<model::bridge>& bridge, std::uint64_t request, const std::vector<model::atom>& ids, std::uint32_t rejected,
+		listener::storage* storage, listener::bridge* changes)
+	{
+		auto lock = this->lock();
+		model::change_set set;
+		if (bridge->settle(request, ids, rejected, set))
+			deliver(bridge, set, storage, changes);
 	}
 
 }
@@ -0,0 +1,44 @@
+#include <shade/change_log.h>
+
+namespace shade {
+	change_log::change_log(size_t capacity)
+		: ring_(capacity ? capacity : 1)
+	{
+	}
+
+	void change_log::push(std::shared_ptr<const model::change_set> set)
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		auto tail = (head_ + size_) % ring_.size();
+		if (size_ == ring_.size()) {
+			dropped_ = ring_[head_]->sequence;
+			head_ = (head_ + 1) % ring_.size();
+		} else
+			++size_;
+		ring_[tail] = std::move(set);
+	}
+
+	void change_log::reset(std::uint64_t sequence)
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		for (auto& set : ring_)
+			set.reset();
+		head_ = 0;
+		size_ = 0;
+		dropped_ = sequence;
+	}
+
+	bool change_log::since(std::uint64_t sequence, std::vector<std::shared_ptr<const model::change_set>>& out) const
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		if (sequence < dropped_)
+			return false;
+
+		for (size_t i = 0; i < size_; ++i) {
+			auto& set = ring_[(head_ + i) % ring_.size()];
+			if (set->sequence > sequence)
+				out.push_back(set);
+		}
+		return true;
+	}
+}
@@ -1,100 +1,441 @@
 #include <shade/discovery.h>
-#include <tangle/msg/http_parser.h>
 #include <tangle/uri.h>
+#include "internal.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <deque>
+#include <unordered_set>
 
 #define DISCOVERY_TIMEOUT 5
+#define DESCRIPTION_TIMEOUT 2000
+#define DESCRIPTION_FANOUT 8
+#define LISTEN_RETRY 5000
 #define STR2(x) #x
 #define STR(x) STR2(x)
 
 namespace shade {
-	discovery::discovery(io::network* net)
+	static constexpr uint32_t ssdp_ip = 0xEFFFFFFA; // 239.255.255.250
+	static constexpr uint16_t ssdp_port = 1900;
+
+	discovery::discovery(io::network* net, io::http* browser)
 		: net_{ net }
-		, udp_socket_(net->udp_socket())
+		, browser_{ browser }
+		, strand_{ net->make_strand() }
+		, known_{ std::make_unique<known_table>() }
 	{
-		uint16_t port = 2000;
-		unsigned int tries = 0;
 		constexpr unsigned int maxtries = 10;
+		auto open = [&](auto&& bind) -> std::unique_ptr<io::udp> {
+			auto socket = net->udp_socket();
+			if (!socket)
+				return {};
+
+			uint16_t port = 2000;
+			unsigned int tries = 0;
+			while (!bind(*socket, port++)) {
+				if (++tries == maxtries) return {};
+			}
+			return socket;
+		};
 
-		if (!udp_socket_)
-			return;
+		// Multi-homed hosts search on every interface; the answers come
+		// back to the socket bound to the address they were sent from.
+		for (auto local : net->interfaces()) {
+			auto socket = open([local](io::udp& udp, uint16_t port) { return udp.bind(local, port); });
+			if (socket && socket->multicast_interface(local))
+				sockets_.push_back(std::move(socket));
+		}
 
-		while (!udp_socket_->bind(port++)) {
-			if (++tries == maxtries) return;
+		if (sockets_.empty()) {
+			auto socket = open([](io::udp& udp, uint16_t port) { return udp.bind(port); });
+			if (socket)
+				sockets_.push_back(std::move(socket));
 		}
 
-		connected_ = true;
+		connected_ = !sockets_.empty();
 	}
 
 	discovery::discovery(discovery&&) = default;
 	discovery& discovery::operator=(discovery&&) = default;
 	discovery::~discovery() = default;
 
-	class discovery_handler {
+	static std::string xml_text(const std::string& xml, size_t start, size_t stop)
+	{
+		static const struct {
+			const char* name;
+			char c;
+		} entities[] = {
+			{ "&amp;", '&' },
+			{ "&lt;", '<' },
+			{ "&gt;", '>' },
+			{ "&quot;", '"' },
+			{ "&apos;", '\'' },
+		};
+
+		std::string out;
+		out.reserve(stop - start);
+		while (start < stop) {
+			auto amp = xml.find('&', start);
+			if (amp == std::string::npos || amp >= stop)
+				amp = stop;
+			out.append(xml, start, amp - start);
+			start = amp;
+			if (start == stop)
+				break;
+
+			bool known = false;
+			for (auto const& entity : entities) {
+				auto length = std::strlen(entity.name);
+				if (length <= stop - start && !xml.compare(start, length, entity.name)) {
+					out.push_back(entity.c);
+					start += length;
+					known = true;
+					break;
+				}
+			}
+			if (!known)
+				out.push_back(xml[start++]);
+		}
+		return out;
+	}
+
+	static std::string xml_field(const std::string& xml, const char* tag)
+	{
+		std::string open = "<";
+		open.append(tag);
+		open.push_back('>');
+		auto start = xml.find(open);
+		if (start == std::string::npos)
+			return {};
+		start += open.length();
+
+		std::string close = "</";
+		close.append(tag);
+		close.push_back('>');
+		auto stop = xml.find(close, start);
+		if (stop == std::string::npos)
+			return {};
+		return xml_text(xml, start, stop);
+	}
+
+	static std::string upper(std::string s)
+	{
+		for (auto& c : s)
+			c = (char)std::toupper((unsigned char)c);
+		return s;
+	}
+
+	// The bridge id is the serial number (the MAC) with FFFE in the middle
+	static bool describe(discovery::description& out, const std::string& xml)
+	{
+		auto serial = upper(xml_field(xml, "serialNumber"));
+		if (serial.length() != 12)
+			return false;
+		if (out.id.length() != 16 || upper(out.id) != serial.substr(0, 6) + "FFFE" + serial.substr(6))
+			return false;
+
+		auto modelid = xml_field(xml, "modelNumber");
+		if (modelid.empty())
+			return false;
+
+		// "Philips hue (192.168.1.2)"
+		auto name = xml_field(xml, "friendlyName");
+		auto paren = name.rfind(" (");
+		if (paren != std::string::npos && name.back() == ')')
+			name.erase(paren);
+
+		std::string mac;
+		for (size_t i = 0; i < serial.length(); i += 2) {
+			if (i)
+				mac.push_back(':');
+			mac.push_back((char)std::tolower((unsigned char)serial[i]));
+			mac.push_back((char)std::tolower((unsigned char)serial[i + 1]));
+		}
+
+		auto base = xml_field(xml, "URLBase");
+		if (!base.empty())
+			out.base = tangle::uri::normal(base, tangle::uri::with_pass).string();
+		out.name = std::move(name);
+		out.mac = std::move(mac);
+		out.modelid = std::move(modelid);
+		return true;
+	}
+
+	// The only fields discovery needs, pointing into the datagram
+	struct ssdp_packet {
+		enum kind_t { response, alive, byebye } kind = response;
+		tangle::cstring id;
+		tangle::cstring location;
+	};
+
+	static bool equal_nocase(tangle::cstring lhs, tangle::cstring rhs)
+	{
+		if (lhs.length() != rhs.length())
+			return false;
+		for (size_t i = 0; i < lhs.length(); ++i) {
+			if (std::tolower((unsigned char)lhs[i]) != std::tolower((unsigned char)rhs[i]))
+				return false;
+		}
+		return true;
+	}
+
+	static bool starts_with(tangle::cstring line, tangle::cstring prefix)
+	{
+		return line.length() >= prefix.length() && line.first(prefix.length()) == prefix;
+	}
+
+	static tangle::cstring trimmed(const char* start, const char* stop)
+	{
+		while (start != stop && (*start == ' ' || *start == '\t'))
+			++start;
+		while (start != stop && (stop[-1] == ' ' || stop[-1] == '\t'))
+			--stop;
+		return { start, size_t(stop - start) };
+	}
+
+	// Either "HTTP/1.1 200 OK", answering the M-SEARCH, or
+	// "NOTIFY * HTTP/1.1", with NTS of ssdp:alive or ssdp:byebye.
+	static bool parse_ssdp(const char* data, size_t length, ssdp_packet& out)
+	{
+		auto cur = data;
+		auto end = data + length;
+		auto next_line = [&] {
+			auto stop = std::find(cur, end, '\n');
+			auto line_end = stop;
+			if (line_end != cur && line_end[-1] == '\r')
+				--line_end;
+			tangle::cstring line{ cur, size_t(line_end - cur) };
+			cur = stop == end ? end : stop + 1;
+			return line;
+		};
+
+		auto first = next_line();
+		bool notify = false;
+		if (starts_with(first, "NOTIFY * HTTP/1."))
+			notify = true;
+		else if (!starts_with(first, "HTTP/1.") || first.find(" 200") == tangle::cstring::npos)
+			return false;
+
+		tangle::cstring nts;
+		while (cur != end) {
+			auto line = next_line();
+			if (line.empty())
+				break;
+
+			auto colon = line.find(':');
+			if (colon == tangle::cstring::npos)
+				continue;
+			auto name = trimmed(line.data(), line.data() + colon);
+			auto value = trimmed(line.data() + colon + 1, line.data() + line.length());
+
+			if (equal_nocase(name, "hue-bridgeid"))
+				out.id = value;
+			else if (equal_nocase(name, "location"))
+				out.location = value;
+			else if (notify && equal_nocase(name, "nts"))
+				nts = value;
+		}
+
+		if (out.id.empty())
+			return false;
+
+		if (notify) {
+			if (nts == "ssdp:byebye") {
+				out.kind = ssdp_packet::byebye;
+				return true;
+			}
+			if (nts != "ssdp:alive")
+				return false;
+			out.kind = ssdp_packet::alive;
+		}
+
+		return !out.location.empty();
+	}
+
+	// Gathers the responders and fetches their descriptions, a few at a
+	// time. Everything past the datagram callback runs on one strand.
+	class discovery_handler : public std::enable_shared_from_this<discovery_handler> {
+		struct fetch {
+			std::string id;
+			std::string location;
+			std::string base;
+		};
+
+		struct attempt {
+			bool finished = false;
+			std::unique_ptr<io::timeout> deadline;
+		};
+
 		discovery* parent;
+		io::http* browser;
+		std::shared_ptr<io::strand> strand;
 		discovery::onbridge callback;
 		discovery::ondone done;
+		std::deque<fetch> queue;
+		std::unordered_set<std::string> pending;
+		std::unordered_set<std::string> expected;
+		bool early;
+		std::atomic<bool> waiting_;
+		size_t in_flight = 0;
+		size_t windows;
+
+		void start(fetch item)
+		{
+			++in_flight;
+			auto self = shared_from_this();
+			auto state = std::make_shared<attempt>();
+			state->deadline = strand->timeout(std::chrono::milliseconds{ DESCRIPTION_TIMEOUT }, [self, this, state, item] {
+				if (state->finished)
+					return;
+				state->finished = true;
+				state->deadline.reset();
+				finish(item, {});
+			});
+
+			browser->get(tangle::uri{ item.location }, io::make_raw_client(strand.get(), [self, this, state, item](int status, std::string body) {
+				if (state->finished)
+					return;
+				state->finished = true;
+				state->deadline.reset();
+				finish(item, status == 200 ? std::move(body) : std::string{});
+			}));
+		}
+
+		void finish(const fetch& item, const std::string& xml)
+		{
+			--in_flight;
+			pending.erase(item.id);
+
+			discovery::description found;
+			found.id = item.id;
+			found.base = item.base;
+			describe(found, xml);
+
+			parent->base_known(found.id, found.base);
+			answered(found.id);
+			callback(found);
+			pump();
+		}
+
+		void answered(const std::string& bridgeid)
+		{
+			if (!early)
+				return;
+			expected.erase(bridgeid);
+			waiting_.store(!expected.empty(), std::memory_order_relaxed);
+		}
+
+		void pump()
+		{
+			while (in_flight < DESCRIPTION_FANOUT && !queue.empty()) {
+				auto item = std::move(queue.front());
+				queue.pop_front();
+				start(std::move(item));
+			}
+
+			auto all_answered = early && expected.empty();
+			if ((!windows || all_answered) && !in_flight && queue.empty() && done) {
+				auto cb = std::move(done);
+				done = nullptr;
+				cb();
+			}
+		}
 	public:
-		discovery_handler(discovery* parent, discovery::onbridge callback, discovery::ondone done)
+		discovery_handler(discovery* parent, std::shared_ptr<io::strand> strand, io::http* browser, size_t windows,
+			discovery::onbridge callback, discovery::ondone done, std::unordered_set<std::string> expected)
 			: parent{ parent }
+			, browser{ browser }
+			, strand{ std::move(strand) }
 			, callback{ std::move(callback) }
 			, done{ std::move(done) }
+			, expected{ std::move(expected) }
+			, early{ !this->expected.empty() }
+			, waiting_{ early }
+			, windows{ windows }
 		{
 		}
 
-		void on_packet(const uint8_t* data, size_t length)
+		void post(std::function<void()>&& cb) { strand->post(std::move(cb)); }
+
+		// Read from any thread: a search still waiting for the expected
+		// bridges needs to hear from the known ones as well.
+		bool waiting() const { return waiting_.load(std::memory_order_relaxed); }
+
+		// Datagrams are parsed in place. Only a bridge that is new, has
+		// moved, or is still expected is copied over to the strand.
+		std::function<void(const uint8_t*, size_t, bool)> reader(bool notify)
 		{
-			tangle::msg::http_response parser{};
+			auto self = shared_from_this();
+			return [self, notify, key = std::string{}](const uint8_t* data, size_t length, bool success) mutable {
+				// a cancelled read reports success with no data
+				if (notify && !success) {
+					self->post([self] { self->parent->relisten(); });
+					return;
+				}
 
-			tangle::msg::parsing result;
-			std::tie(std::ignore, result) = parser.append((const char*)data, length);
-			if (result == tangle::msg::parsing::reading)
-				std::tie(std::ignore, result) = parser.append("\r\n", 2);
+				if (!success || length == 0) {
+					self->post([self] { self->on_done(); });
+					return;
+				}
 
-			if (result != tangle::msg::parsing::separator)
-				return;
+				ssdp_packet packet;
+				if (!parse_ssdp((const char*)data, length, packet) || (packet.kind == ssdp_packet::response) == notify)
+					return;
 
-			auto dict = parser.dict();
+				if (packet.kind == ssdp_packet::byebye) {
+					self->post([self, id = packet.id.str()] { self->parent->byebye(id); });
+					return;
+				}
 
-			auto it = dict.find("hue-bridgeid");
-			if (it == dict.end() || it->second.empty())
-				return;
-			auto bridgeid = it->second.front();
+				// the key keeps its capacity from one datagram to the next
+				key.assign(packet.id.data(), packet.id.length());
+				if (!self->waiting() && self->parent->known(key, packet.location))
+					return;
 
-			it = dict.find("location");
-			if (it == dict.end() || it->second.empty())
-				return;
-			auto location = tangle::uri::normal(it->second.front(), tangle::uri::with_pass).string();
+				self->post([self, id = key, location = packet.location.str()] { self->on_announce(id, location); });
+			};
+		}
 
-			// 3. note the id as "seen"
-			if (parent->seen(bridgeid, location))
+		void on_announce(const std::string& bridgeid, const std::string& location)
+		{
+			// 3. note the id as "seen", once per search; a bridge already
+			//    known at this location has answered all the same
+			if (pending.count(bridgeid))
 				return;
+			if (parent->seen(bridgeid, location)) {
+				answered(bridgeid);
+				pump();
+				return;
+			}
 
-			// 4. get the contents of the xml
-			// 5. extract the base address
-			// TODO: actually take the description.xml contents...
-			auto base = tangle::uri{ location }
+			// 4. get the contents of the xml, with the stripped location
+			//    as the base address, should the description fail
+			auto address = tangle::uri::normal(location, tangle::uri::with_pass);
+			auto base = tangle::uri{ address }
 				.fragment({})
 				.query({})
 				.path({})
 				.string();
-			parent->base_known(bridgeid, base);
-			// 6. for each bridge report the (id, base address) to callback
-			callback(bridgeid, base);
+			pending.insert(bridgeid);
+			queue.push_back({ bridgeid, address.string(), std::move(base) });
+			pump();
 		}
 
+		// one search window per socket
 		void on_done()
 		{
-			done();
+			if (windows)
+				--windows;
+			pump();
 		}
 	};
 
-	bool discovery::search(onbridge callback, ondone done)
+	bool discovery::search(onbridge callback, ondone done, std::unordered_set<std::string> expected)
 	{
-		current_search_.reset();
+		current_search_.clear();
 
 		constexpr std::chrono::seconds ssdp_timeout{ DISCOVERY_TIMEOUT };
-		constexpr uint32_t ssdp_ip = 0xEFFFFFFA; // 239.255.255.250
-		constexpr uint16_t ssdp_port = 1900;
 		constexpr uint8_t packet[] =
 			"M-SEARCH * HTTP/1.1\r\n"
 			"HOST: 239.255.255.250:1900\r\n"
@@ -102,33 +443,99 @@ namespace shade {
 			"MX: " STR(DISCOVERY_TIMEOUT) "\r\n"
 			"ST: libhue:idl\r\n";
 
-		// 1. send out a packet, in triplicate
-		if (!udp_socket_->write_datagram(packet, sizeof(packet) - 1, ssdp_ip, ssdp_port))
-			return false;
-		if (!udp_socket_->write_datagram(packet, sizeof(packet) - 1, ssdp_ip, ssdp_port))
-			return false;
-		if (!udp_socket_->write_datagram(packet, sizeof(packet) - 1, ssdp_ip, ssdp_port))
+		// 1. send out a packet, in triplicate, on every interface
+		size_t sent = 0;
+		for (auto& socket : sockets_) {
+			bool ok = true;
+			for (int i = 0; ok && i < 3; ++i)
+				ok = socket->write_datagram(packet, sizeof(packet) - 1, ssdp_ip, ssdp_port);
+			if (ok)
+				++sent;
+		}
+		if (!sent)
 			return false;
 
-		// 2. gather the (id, location) pair
-		auto handler = std::make_shared<discovery_handler>(this, std::move(callback), std::move(done));
-		current_search_ = udp_socket_->read_datagram(ssdp_timeout, [handler](const uint8_t* data, size_t length, bool success) {
-			if (!success)
-				return;
+		// 2. gather the (id, location) pairs from all of them
+		auto handler = std::make_shared<discovery_handler>(this, strand_, browser_, sockets_.size(),
+			std::move(callback), std::move(done), std::move(expected));
+		for (auto& socket : sockets_) {
+			auto reader = socket->read_datagram(ssdp_timeout, handler->reader(false));
+			if (reader)
+				current_search_.push_back(std::move(reader));
+			else
+				handler->post([handler] { handler->on_done(); });
+		}
+		return true;
+	}
 
-			if (length == 0) {
-				handler->on_done();
-				return;
+	bool discovery::listen(onbridge callback, ongone gone)
+	{
+		announced_ = std::move(callback);
+		gone_ = std::move(gone);
+		relisten_.reset();
+		listening_.reset();
+
+		if (!notify_socket_) {
+			auto socket = net_->udp_socket();
+			if (!socket || !socket->reuse_address() || !socket->bind(ssdp_port))
+				return false;
+
+			auto locals = net_->interfaces();
+			if (locals.empty())
+				locals.push_back(0); // let the system choose
+
+			bool joined = false;
+			for (auto local : locals) {
+				if (socket->join_group(ssdp_ip, local))
+					joined = true;
 			}
-			handler->on_packet(data, length);
+			if (!joined)
+				return false;
+
+			notify_socket_ = std::move(socket);
+		}
+
+		return listen();
+	}
+
+	bool discovery::listen()
+	{
+		auto handler = std::make_shared<discovery_handler>(this, strand_, browser_, 1,
+			announced_, nullptr, std::unordered_set<std::string>{});
+		listening_ = notify_socket_->read_datagram(std::chrono::milliseconds{}, handler->reader(true));
+		return !!listening_;
+	}
+
+	// Called on the strand, after the read failed
+	void discovery::relisten()
+	{
+		listening_.reset();
+		relisten_ = strand_->timeout(std::chrono::milliseconds{ LISTEN_RETRY }, [this] {
+			if (!listen())
+				relisten();
 		});
-		return true;
+	}
+
+	void discovery::byebye(const std::string& bridgeid)
+	{
+		forget(bridgeid);
+		if (gone_)
+			gone_(bridgeid);
+	}
+
+	bool discovery::known(const std::string& bridgeid, const tangle::cstring& location) const
+	{
+		std::lock_guard<std::mutex> guard{ known_->lock };
+		auto known = known_->bridges.find(bridgeid);
+		return known != known_->bridges.end() && tangle::cstring{ known->second.location } == location;
 	}
 
 	bool discovery::seen(const std::string& bridgeid, const std::string& location)
 	{
-		auto known = known_bridges_.find(bridgeid);
-		if (known != known_bridges_.end()) {
+		std::lock_guard<std::mutex> guard{ known_->lock };
+		auto& bridges = known_->bridges;
+		auto known = bridges.find(bridgeid);
+		if (known != bridges.end()) {
 			if (known->second.location == location)
 				return true;
 			known->second.location = location; // new lease?
@@ -136,21 +543,31 @@ namespace shade {
 			return false;
 		}
 
-		known_bridges_[bridgeid].location = location;
+		bridges[bridgeid].location = location;
 		return false;
 	}
 
 	bool discovery::base_known(const std::string& bridgeid, const std::string& base)
 	{
-		auto known = known_bridges_.find(bridgeid);
-		if (known != known_bridges_.end()) {
+		std::lock_guard<std::mutex> guard{ known_->lock };
+		auto& bridges = known_->bridges;
+		auto known = bridges.find(bridgeid);
+		if (known != bridges.end()) {
 			if (known->second.base == base)
 				return true;
 			known->second.base = base; // new lease?
 			return false;
 		}
 
-		known_bridges_[bridgeid].base = base;
+		bridges[bridgeid].base = base;
 		return false;
 	}
+
+	// A bridge saying goodbye is described again once it is back, even
+	// at the same address.
+	void discovery::forget(const std::string& bridgeid)
+	{
+		std::lock_guard<std::mutex> guard{ known_->lock };
+		known_->bridges.erase(bridgeid);
+	}
 }
@@ -9,17 +9,30 @@
 using namespace std::literals;
 
 namespace shade {
-	heartbeat::heartbeat(cache* view, listener::manager* listener, io::network* net, const std::shared_ptr<model::bridge>& bridge)
+	heartbeat::heartbeat(cache* view, listener::manager* listener, io::network* net, workers* pool, const std::shared_ptr<model::bridge>& bridge)
 		: view_{ view }
 		, listener_{ listener }
 		, net_{ net }
+		, pool_{ pool }
 		, bridge_{ bridge }
+		, strand_{ net->make_strand() }
 	{
 	}
 
+	void heartbeat::start()
+	{
+		auto self = shared_from_this();
+		strand_->post([self, this] {
+			view_->hydrate(bridge_);
+			tick();
+		});
+	}
+
 	void heartbeat::stop()
 	{
-		timeout_.reset();
+		stopped_ = true;
+		auto self = shared_from_this();
+		strand_->post([self, this] { timeout_.reset(); });
 	}
 
 	bool heartbeat::reconnect(json::value doc)
@@ -36,46 +49,76 @@ namespace shade {
 		return false;
 	}
 
+	class storage_listener : public listener::storage {
+		bool dirty_ = false;
+		cache* parent_;
+	public:
+		storage_listener(cache* parent) : parent_{ parent } {}
+		~storage_listener() {
+			if (dirty_)
+				shade::storage::store(*parent_);
+		}
+
+		void mark_dirty() { dirty_ = true; }
+	};
+
 	void heartbeat::tick() {
-		class storage_listener : public listener::storage {
-			bool dirty_ = false;
-			cache* parent_;
-		public:
-			storage_listener(cache* parent) : parent_{ parent } {}
-			~storage_listener() {
-				if (dirty_)
-					shade::storage::store(*parent_);
-			}
+		if (stopped_)
+			return;
 
-			void mark_dirty() { dirty_ = true; }
-		};
+		timeout_ = strand_->timeout(1s, [=] { tick(); });
 
-		timeout_ = net_->timeout(1s, [=] { tick(); });
+		// Both bodies are parsed as they arrive and collected on the
+		// strand; unpacking and comparing them with the model happens on
+		// the worker pool, and only the differences come back to be
+		// applied.
+		auto self = shared_from_this();
+		auto lock = view_->lock();
+		bridge_->logged(view_->browser()).get("/lights", io::make_client(strand_.get(), [self, this](int, json::value lights) {
+			auto lock = view_->lock();
+			bridge_->logged(view_->browser()).get("/groups", io::make_client(strand_.get(), [self, this, lights](int, json::value groups) {
+				auto snapshot = [&] {
+					auto lock = view_->lock();
+					return bridge_->snapshot();
+				}();
+
+				// With the pool busy, this tick is dropped; the next one
+				// will bring a fresher state anyway.
+				pool_->submit([self, this, lights, groups, snapshot = std::move(snapshot)] {
+					decode(lights, groups, snapshot);
+				});
+			}));
+		}));
+	}
 
+	void heartbeat::decode(json::value lights, json::value groups, const model::bridge_snapshot& snapshot)
+	{
+		hue::sources sources;
 		auto self = shared_from_this();
-		bridge_->logged(view_->browser()).get("/lights", io::make_client([self, this](int status, json::value doc) {
-			std::unordered_map<std::string, hue::light> lights;
-			if (unpack_json(lights, doc)) {
-				bridge_->logged(view_->browser()).get("/groups", io::make_client([self, this, lights = std::move(lights)](int status, json::value doc) {
-					std::unordered_map<std::string, hue::group> groups;
-					if (unpack_json(groups, doc)) {
-						storage_listener listener{ view_ };
-						view_->bridge_lights(bridge_, std::move(lights), std::move(groups), &listener, listener_->bridge_listener(bridge_));
-						return;
-					}
-
-					if (reconnect(doc))
-						return;
-
-					// printf("GETTING GROUPS: %d\n%s\n", status, doc.to_string(json::value::options::indented()).c_str());
-				}));
-				return;
-			}
 
-			if (reconnect(doc))
-				return;
+		if (!unpack_json(sources.lights, lights)) {
+			strand_->post([self, this, lights] { reconnect(lights); });
+			return;
+		}
 
-			// printf("GETTING LIGHTS: %d\n%s\n", status, doc.to_string(json::value::options::indented()).c_str());
-		}));
+		if (!unpack_json(sources.groups, groups)) {
+			strand_->post([self, this, groups] { reconnect(groups); });
+			return;
+		}
+
+		auto diff = model::compute_diff(snapshot, sources, *view_->atoms());
+		if (diff.empty())
+			return;
+
+		strand_->post([self, this, diff = std::move(diff)]() mutable { apply(diff); });
+	}
+
+	void heartbeat::apply(model::bridge_diff& diff)
+	{
+		if (stopped_)
+			return;
+
+		storage_listener listener{ view_ };
+		view_->bridge_changed(bridge_, diff, &listener, listener_->bridge_listener(bridge_));
 	}
 }
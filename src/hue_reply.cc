@@ -0,0 +1,76 @@
+#include <shade/hue_reply.h>
+#include "internal.h"
+
+namespace shade { namespace hue {
+	bool get_error(error_type& error, json::value doc)
+	{
+		std::vector<std::unordered_map<std::string, error_type>> ctx;
+		if (!unpack_json(ctx, doc))
+			return false;
+		if (ctx.empty() || ctx.front().empty())
+			return false;
+
+		auto it = ctx.front().find("error");
+		if (it == ctx.front().end())
+			return false;
+
+		error = std::move(it->second);
+		return true;
+	}
+
+	bool get_error(errors& code, json::value doc)
+	{
+		error_type err;
+		if (!get_error(err, doc))
+			return false;
+		code = (errors)err.type;
+		return true;
+	}
+
+	bool get_put_reply(put_reply& reply, json::value doc)
+	{
+		if (!doc.is<json::VECTOR>())
+			return false;
+
+		for (auto elem : json::vector{ doc }) {
+			auto success = map(elem, "success");
+			if (success.is<json::MAP>()) {
+				for (auto const& pair : json::map{ success })
+					reply.applied.push_back(pair.first);
+				continue;
+			}
+
+			error_type error;
+			if (unpack_json(error, map(elem, "error")))
+				reply.errors.push_back(std::move(error));
+		}
+		return true;
+	}
+
+	json::value username(json::value doc)
+	{
+		json::value out;
+		find_first(doc, [&](json::value child) {
+			out = map(map(child, "success"), "username");
+			return !out.is<json::NULLPTR>();
+		});
+		return out;
+	}
+
+	bool split_api(const std::string& resource, std::string& username, std::string& rest)
+	{
+		static const std::string api = "/api/";
+		if (resource.compare(0, api.length(), api))
+			return false;
+
+		auto slash = resource.find('/', api.length());
+		if (slash == std::string::npos) {
+			username = resource.substr(api.length());
+			rest.clear();
+		} else {
+			username = resource.substr(api.length(), slash - api.length());
+			rest = resource.substr(slash);
+		}
+		return !username.empty();
+	}
+} }
@@ -1,5 +1,6 @@
 #include <shade/manager.h>
 #include <shade/hue_data.h>
+#include <shade/hue_reply.h>
 #include <json.hpp>
 
 using namespace std::literals;
@@ -57,11 +58,13 @@ namespace shade {
 			Handler handler_;
 			std::unique_ptr<http::handler> load_handler_;
 			int status_ = 0;
-			std::vector<char> data_;
+			json::stream_parser parser_;
+			io::strand* strand_ = nullptr;
 		public:
 
-			http_client(Handler handler)
+			http_client(Handler handler, io::strand* strand = nullptr)
 				: handler_{ std::move(handler) }
+				, strand_{ strand }
 			{
 			}
 
@@ -78,30 +81,73 @@ namespace shade {
 			void on_data(const char* data, size_t length) override
 			{
 				if (length == 0) {
-					auto value = json::from_string(data_.data(), data_.size());
-					// if (value.is<json::NULLPTR>()) {
-					// 	printf("%s\n", std::string{ data_.data(), data_.size() }.c_str());
-					// }
-					data_.clear();
-					handler_(status_, value);
+					auto value = parser_.finish();
+					if (strand_) {
+						strand_->post([handler = std::move(handler_), status = status_, value]() mutable {
+							handler(status, value);
+						});
+					} else
+						handler_(status_, value);
 					load_handler_.reset(); // this will start a destroy cascade
 					return;                // so do not touch anything and run...
 				}
-				data_.insert(data_.end(), data, data + length);
+				parser_.feed(data, length);
 			}
 		};
 
 		template <typename Handler>
 		class http_json_client : public http_client<Handler> {
 		public:
-			http_json_client(Handler handler)
-				: http_client<Handler>{ std::move(handler) }
+			http_json_client(Handler handler, io::strand* strand = nullptr)
+				: http_client<Handler>{ std::move(handler), strand }
 			{
 			}
 
 			tangle::cstring content_type() override { return "text/json"; }
 		};
 
+		// Keeps the body as it came, for the caller to decode elsewhere.
+		template <typename Handler>
+		class http_raw_client : public http::listener {
+			Handler handler_;
+			std::unique_ptr<http::handler> load_handler_;
+			int status_ = 0;
+			std::string body_;
+			io::strand* strand_ = nullptr;
+		public:
+
+			http_raw_client(Handler handler, io::strand* strand = nullptr)
+				: handler_{ std::move(handler) }
+				, strand_{ strand }
+			{
+			}
+
+			void set_handler(std::unique_ptr<http::handler> handler) override
+			{
+				load_handler_ = std::move(handler);
+			}
+
+			void on_headers(int status, const tangle::cstring& reason, const http::headers& headers) override
+			{
+				status_ = status;
+			}
+
+			void on_data(const char* data, size_t length) override
+			{
+				if (length == 0) {
+					if (strand_) {
+						strand_->post([handler = std::move(handler_), status = status_, body = std::move(body_)]() mutable {
+							handler(status, std::move(body));
+						});
+					} else
+						handler_(status_, std::move(body_));
+					load_handler_.reset();
+					return;
+				}
+				body_.append(data, length);
+			}
+		};
+
 		template <typename Handler>
 		auto make_client(Handler handler)
 		{
@@ -114,6 +160,25 @@ namespace shade {
 			return std::make_unique<http_json_client<Handler>>(std::move(handler));
 		}
 
+		// The handler is called on the strand, after the body is parsed.
+		template <typename Handler>
+		auto make_client(io::strand* strand, Handler handler)
+		{
+			return std::make_unique<http_client<Handler>>(std::move(handler), strand);
+		}
+
+		template <typename Handler>
+		auto make_json_client(io::strand* strand, Handler handler)
+		{
+			return std::make_unique<http_json_client<Handler>>(std::move(handler), strand);
+		}
+
+		template <typename Handler>
+		auto make_raw_client(io::strand* strand, Handler handler)
+		{
+			return std::make_unique<http_raw_client<Handler>>(std::move(handler), strand);
+		}
+
 	}
 
 	template <typename T>
@@ -165,29 +230,4 @@ namespace shade {
 
 		return pred;
 	}
-
-	static inline bool get_error(hue::error_type& error, json::value doc)
-	{
-		std::vector<std::unordered_map<std::string, hue::error_type>> ctx;
-		if (!unpack_json(ctx, doc))
-			return false;
-		if (ctx.empty() || ctx.front().empty())
-			return false;
-
-		auto it = ctx.front().find("error");
-		if (it == ctx.front().end())
-			return false;
-
-		error = std::move(it->second);
-		return true;
-	}
-
-	static inline bool get_error(hue::errors& code, json::value doc)
-	{
-		hue::error_type err;
-		if (!get_error(err, doc))
-			return false;
-		code = (hue::errors)err.type;
-		return true;
-	}
 }
@@ -0,0 +1,19 @@
+#include <shade/io/endpoint.h>
+#include <tangle/uri.h>
+
+namespace shade { namespace io {
+	endpoint::endpoint(const std::string& base)
+		: base_{ base }
+	{
+		tangle::uri address{ base };
+		auto auth = tangle::uri::auth_builder::parse(address.authority());
+
+		host_ = std::move(auth.host);
+		service_ = auth.port.empty() ? address.scheme().str() : auth.port;
+
+		host_field_ = "Host: " + host_;
+		if (!auth.port.empty())
+			host_field_ += ":" + auth.port;
+		host_field_ += "\r\n";
+	}
+} }
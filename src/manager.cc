@@ -5,6 +5,11 @@
 #include <shade/io/connection.h>
 #include "internal.h"
 #include <algorithm>
+#include <cmath>
+#include <deque>
+
+#define UPDATE_FANOUT 4
+#define DOUBLE_LIMIT 1e9
 
 using namespace std::literals;
 
@@ -34,23 +39,63 @@ namespace shade {
 	{
 		listener_->onload(view_);
 
-		discovery_.search([this](std::string const& id, std::string const& base) {
-			storage_listener listener{ &view_ };
-			view_.bridge_located(id, base, &listener);
-			auto bridge = view_.get(id);
-			if (!bridge)
-				return;
+		// the bridges from the last run are the ones waited for
+		std::unordered_set<std::string> expected;
+		{
+			auto lock = view_.lock();
+			for (auto const& bridge : view_)
+				expected.insert(bridge.first);
+		}
 
-			get_config(bridge->unlogged(view_.browser()));
+		discovery_.search([this](const discovery::description& found) {
+			bridge_found(found);
 		}, [this] {
 			// retry all unactivated cached bridges
+			auto lock = view_.lock();
 			for (auto const& bridge : view_) {
 				if (bridge.second->seen()) continue;
 				get_config(bridge.second->unlogged(view_.browser()));
 			}
+		}, std::move(expected));
+	}
+
+	bool manager::listen()
+	{
+		return discovery_.listen([this](const discovery::description& found) {
+			bridge_found(found);
+		}, [this](const std::string& id) {
+			bridge_gone(id);
 		});
 	}
 
+	void manager::bridge_gone(const std::string& id)
+	{
+		auto bridge = view_.get(id);
+		if (!bridge)
+			return;
+
+		view_.bridge_gone(bridge);
+		listener_->ongone(bridge);
+	}
+
+	void manager::bridge_found(const discovery::description& found)
+	{
+		storage_listener listener{ &view_ };
+		view_.bridge_located(found.id, found.base, &listener);
+		auto bridge = view_.get(found.id);
+		if (!bridge)
+			return;
+
+		if (found.described()) {
+			view_.bridge_named(found.id, found.name, found.mac, found.modelid, &listener);
+			listener_->onbridge(bridge);
+			return;
+		}
+
+		auto lock = view_.lock();
+		get_config(bridge->unlogged(view_.browser()));
+	}
+
 	void manager::store_cache()
 	{
 		storage::store(view_);
@@ -106,31 +151,24 @@ namespace shade {
 
 		auto then = std::chrono::steady_clock::now();
 		auto json = userdefinition(view_.current_host());
+		auto lock = view_.lock();
 		bridge->unlogged(view_.browser()).post("", json, io::make_json_client([=](int status, json::value doc) {
 			getuser(bridge, status, doc, sofar, then);
 		}));
 	}
 
-	static inline json::value username(json::value doc)
-	{
-		json::value out;
-		find_first(doc, [&](json::value child) {
-			out = map(map(child, "success"), "username");
-			return !out.is<json::NULLPTR>();
-		});
-		return out;
-	}
-
 	void manager::getuser(const std::shared_ptr<model::bridge>& bridge, int status, json::value doc, std::chrono::nanoseconds sofar, std::chrono::steady_clock::time_point then)
 	{
 		auto listener = listener_->connection_listener(bridge);
 
 		if (status / 100 < 4) {
-			auto value = username(doc);
+			auto value = hue::username(doc);
 			if (value.is<json::STRING>()) {
 				auto username = value.as<json::STRING>();
-				bridge->host().update(username);
-				store_cache();
+				{
+					storage_listener storage{ &view_ };
+					view_.bridge_connected(bridge, username, &storage);
+				}
 				if (listener)
 					listener->onconnected(bridge);
 				return;
@@ -140,9 +178,18 @@ namespace shade {
 		hue::errors error;
 		if (get_error(error, doc)) {
 			if (error == hue::errors::button_not_pressed) {
+				std::lock_guard<std::mutex> guard{ timeouts_lock_ };
 				auto& timeout = timeouts_[bridge->id()];
 				timeout = net_->timeout(300ms, [=]() {
-					timeouts_.erase(bridge->id());
+					std::unique_ptr<io::timeout> self;
+					{
+						std::lock_guard<std::mutex> guard{ timeouts_lock_ };
+						auto it = timeouts_.find(bridge->id());
+						if (it != timeouts_.end()) {
+							self = std::move(it->second);
+							timeouts_.erase(it);
+						}
+					}
 					auto now = std::chrono::steady_clock::now();
 					connect(bridge, sofar + (now - then));
 				});
@@ -172,53 +219,561 @@ namespace shade {
 
 	std::shared_ptr<heart_monitor> manager::defib(const std::shared_ptr<model::bridge>& bridge)
 	{
-		auto beat = std::make_shared<heartbeat>(&view_, listener_, net_, bridge);
+		auto beat = std::make_shared<heartbeat>(&view_, listener_, net_, &workers_, bridge);
 		beat->start();
 		return std::make_shared<monitor>(std::move(beat));
 	}
 
-	template <typename Pred>
-	inline void group_cutoff(const std::shared_ptr<shade::model::light_source>& source, Pred pred)
+	void manager::update(const std::shared_ptr<shade::model::light_source>& source, const change_def& change)
 	{
-		if (source->is_group()) {
-			auto group = std::static_pointer_cast<shade::model::group>(source);
-			if (group->lights().size() < 2) {
-				for (auto const& light : group->lights()) {
-					pred(light);
-				}
-				return;
+		update(change_list{ { source, change } });
+	}
+
+	// Writes a change_def's body without going through json::value; the
+	// longest possible body is well within the buffer.
+	class body_writer {
+		char buffer_[256];
+		size_t size_ = 0;
+		bool first_ = true;
+
+		void put(char c)
+		{
+			if (size_ < sizeof(buffer_))
+				buffer_[size_++] = c;
+		}
+
+		void append(const char* s)
+		{
+			while (*s)
+				put(*s++);
+		}
+	public:
+		body_writer() { put('{'); }
+
+		body_writer& key(const char* name)
+		{
+			if (!first_)
+				put(',');
+			first_ = false;
+			put('"');
+			append(name);
+			append("\":");
+			return *this;
+		}
+
+		body_writer& value(bool val)
+		{
+			append(val ? "true" : "false");
+			return *this;
+		}
+
+		body_writer& value(int val)
+		{
+			char digits[12];
+			size_t count = 0;
+			auto magnitude = val < 0 ? 0u - unsigned(val) : unsigned(val);
+			do {
+				digits[count++] = char('0' + magnitude % 10);
+				magnitude /= 10;
+			} while (magnitude);
+			if (val < 0)
+				put('-');
+			while (count)
+				put(digits[--count]);
+			return *this;
+		}
+
+		// Written by hand, so the decimal point does not follow the locale.
+		// The bridge keeps four decimals and has no use for nan or inf.
+		body_writer& value(double val)
+		{
+			if (!std::isfinite(val))
+				val = 0;
+			auto scaled = std::llround(std::min(std::max(val, -DOUBLE_LIMIT), DOUBLE_LIMIT) * 10000);
+			if (scaled < 0) {
+				put('-');
+				scaled = -scaled;
 			}
+			value(int(scaled / 10000));
+
+			auto fraction = int(scaled % 10000);
+			if (!fraction)
+				return *this;
+
+			char digits[4];
+			for (size_t index = 4; index--; fraction /= 10)
+				digits[index] = char('0' + fraction % 10);
+			size_t count = 4;
+			while (digits[count - 1] == '0')
+				--count;
+			put('.');
+			for (size_t index = 0; index < count; ++index)
+				put(digits[index]);
+			return *this;
+		}
+
+		body_writer& raw(char c)
+		{
+			put(c);
+			return *this;
+		}
+
+		std::string str()
+		{
+			put('}');
+			return { buffer_, size_ };
 		}
+	};
 
-		pred(source);
+	void change_def::render() const
+	{
+		body_writer out;
+		if (fields_ & field_on)
+			out.key("on").value(on_);
+		if (fields_ & field_bri)
+			out.key("bri").value(bri_);
+		if (fields_ & field_hue_sat) {
+			out.key("hue").value(hue_sat_.hue);
+			out.key("sat").value(hue_sat_.sat);
+		}
+		if (fields_ & field_xy)
+			out.key("xy").raw('[').value(xy_.x).raw(',').value(xy_.y).raw(']');
+		if (fields_ & field_ct)
+			out.key("ct").value(ct_.val);
+		body_ = out.str();
 	}
 
-	void manager::update(const std::shared_ptr<shade::model::light_source>& source, const change_def& change)
+	model::source_patch change_def::patch() const
 	{
-		if (source->is_group()) {
-			auto group = std::static_pointer_cast<shade::model::group>(source);
-			if (group->lights().size() < 10) {
-				for (auto const& light : group->lights()) {
-					do_update(light, change);
-				}
+		model::source_patch out;
+		if (fields_ & field_on) {
+			out.fields |= model::field_on;
+			out.on = on_;
+		}
+		if (fields_ & field_bri) {
+			out.fields |= model::field_bri;
+			out.bri = bri_;
+		}
+		if (fields_ & field_color) {
+			out.fields |= model::field_value;
+			if (fields_ & field_hue_sat)
+				out.value = hue_sat_;
+			else if (fields_ & field_xy)
+				out.value = xy_;
+			else
+				out.value = ct_;
+		}
+		return out;
+	}
+
+	bool change_def::operator == (const change_def& rhs) const
+	{
+		if (fields_ != rhs.fields_)
+			return false;
+		if ((fields_ & field_on) && on_ != rhs.on_)
+			return false;
+		if ((fields_ & field_bri) && bri_ != rhs.bri_)
+			return false;
+		if ((fields_ & field_hue_sat) && (hue_sat_.hue != rhs.hue_sat_.hue || hue_sat_.sat != rhs.hue_sat_.sat))
+			return false;
+		if ((fields_ & field_xy) && (xy_.x != rhs.xy_.x || xy_.y != rhs.xy_.y))
+			return false;
+		if ((fields_ & field_ct) && ct_.val != rhs.ct_.val)
+			return false;
+		return true;
+	}
+
+	static constexpr std::uint32_t all_fields = model::field_on | model::field_bri | model::field_value;
+
+	// "/lights/1/state/bri" names one field; an address without one, like
+	// "/lights/1/state", or one this code does not know, stands for the
+	// whole command.
+	static std::uint32_t fields_of(const std::string& address)
+	{
+		auto slash = address.rfind('/');
+		auto name = slash == std::string::npos ? address : address.substr(slash + 1);
+		if (name.empty() || name == "state" || name == "action")
+			return all_fields;
+		if (name == "on")
+			return model::field_on;
+		if (name == "bri")
+			return model::field_bri;
+		if (name == "hue" || name == "sat" || name == "xy" || name == "ct")
+			return model::field_value;
+		return all_fields;
+	}
+
+	update_result command_result(std::uint32_t asked, int status, json::value doc)
+	{
+		update_result out;
+		out.status = status;
+		out.rejected = all_fields;
+
+		hue::put_reply reply;
+		if (status / 100 != 2 || !get_put_reply(reply, doc))
+			return out;
+
+		out.rejected = 0;
+		for (auto const& address : reply.applied)
+			out.applied |= fields_of(address);
+		for (auto const& error : reply.errors)
+			out.rejected |= fields_of(error.address);
+		out.applied &= asked & ~out.rejected;
+		// a field the reply does not confirm was not set
+		out.rejected |= asked & ~out.applied;
+		out.errors = std::move(reply.errors);
+		return out;
+	}
+
+	class batch : public std::enable_shared_from_this<batch> {
+	public:
+		struct command {
+			std::string resource;
+			size_t body;
+			std::vector<size_t> items;
+			bool group = false;
+		};
+
+		// Commands are sent in the windows the planner counted on; once a
+		// window's budget is spent, the queue waits for the next one.
+		struct bridge_queue {
+			io::connection conn;
+			std::deque<command> waiting;
+			size_t in_flight = 0;
+			std::chrono::steady_clock::time_point opened;
+			size_t lights = 0;
+			size_t groups = 0;
+			std::unique_ptr<io::timeout> next_window;
+		};
+
+		batch(size_t items, io::network* net, const model::rate_budget& budget, manager::onbatch done)
+			: net_{ net }
+			, budget_{ budget }
+			, done_{ std::move(done) }
+		{
+			result_.items.resize(items);
+		}
+
+		// The sources each item changed ahead of time; settled with the
+		// item's result, once all the replies are in.
+		void optimistic(cache* view, listener::manager* listener, std::uint64_t request)
+		{
+			view_ = view;
+			listener_ = listener;
+			request_ = request;
+			touched_.resize(result_.items.size());
+		}
+
+		void touched(size_t item, std::shared_ptr<model::bridge> bridge, std::vector<model::atom> ids)
+		{
+			touched_[item] = { std::move(bridge), std::move(ids) };
+		}
+
+		// The light is left to a later item; this one must not settle it
+		void superseded(size_t item, model::atom light)
+		{
+			result_.items[item].superseded = true;
+			if (touched_.empty())
+				return;
+			auto& ids = touched_[item].ids;
+			ids.erase(std::remove(ids.begin(), ids.end(), light), ids.end());
+		}
+
+		size_t body(const change_def& change)
+		{
+			bodies_.push_back(change.body());
+			asked_.push_back(change.patch().fields);
+			return bodies_.size() - 1;
+		}
+
+		bridge_queue* queue(io::connection conn)
+		{
+			queues_.push_back(std::make_unique<bridge_queue>());
+			queues_.back()->conn = std::move(conn);
+			return queues_.back().get();
+		}
+
+		void push(bridge_queue* queue, command cmd)
+		{
+			queue->waiting.push_back(std::move(cmd));
+			++outstanding_;
+		}
+
+		void start()
+		{
+			if (!outstanding_) {
+				finish();
 				return;
 			}
+
+			for (auto& queue : queues_)
+				pump(queue.get());
 		}
+	private:
+		std::mutex lock_;
+		std::vector<std::string> bodies_;
+		std::vector<std::uint32_t> asked_; // the fields each body sets
+		std::vector<std::unique_ptr<bridge_queue>> queues_;
+		size_t outstanding_ = 0;
+		io::network* net_;
+		model::rate_budget budget_;
+		batch_result result_;
+		manager::onbatch done_;
 
-		do_update(source, change);
-	}
+		struct sources {
+			std::shared_ptr<model::bridge> bridge;
+			std::vector<model::atom> ids;
+		};
+		cache* view_ = nullptr;
+		listener::manager* listener_ = nullptr;
+		std::uint64_t request_ = 0;
+		std::vector<sources> touched_;
+
+		// a failed send reports back synchronously, so nothing is sent
+		// with the lock held
+		void pump(bridge_queue* queue)
+		{
+			while (true) {
+				command cmd;
+				{
+					std::lock_guard<std::mutex> guard{ lock_ };
+					if (queue->in_flight >= UPDATE_FANOUT || queue->waiting.empty() || queue->next_window)
+						return;
+
+					auto it = next(queue);
+					if (it == queue->waiting.end())
+						return;
+					cmd = std::move(*it);
+					queue->waiting.erase(it);
+					++queue->in_flight;
+				}
+
+				auto self = shared_from_this();
+				queue->conn.put(cmd.resource, bodies_[cmd.body], io::make_json_client([self, queue, asked = asked_[cmd.body], items = std::move(cmd.items)](int status, json::value doc) {
+					self->finished(queue, items, asked, status, doc);
+				}));
+			}
+		}
+
+		// The first command the current window still has room for; groups
+		// and lights cover different lights, so either may go first.
+		std::deque<command>::iterator next(bridge_queue* queue)
+		{
+			auto now = std::chrono::steady_clock::now();
+			if (now - queue->opened >= budget_.window) {
+				queue->opened = now;
+				queue->lights = 0;
+				queue->groups = 0;
+			}
+
+			auto it = std::find_if(queue->waiting.begin(), queue->waiting.end(), [&](const command& cmd) {
+				return cmd.group
+					? queue->groups < std::max(budget_.groups, size_t(1))
+					: queue->lights < std::max(budget_.lights, size_t(1));
+			});
+
+			if (it == queue->waiting.end()) {
+				auto left = std::chrono::duration_cast<std::chrono::milliseconds>(queue->opened + budget_.window - now) + 1ms;
+				auto self = shared_from_this();
+				if (net_) {
+					queue->next_window = net_->timeout(left, [self, queue] {
+						std::unique_ptr<io::timeout> done;
+						{
+							std::lock_guard<std::mutex> guard{ self->lock_ };
+							done = std::move(queue->next_window);
+						}
+						self->pump(queue);
+					});
+				}
+				if (queue->next_window)
+					return it;
+				it = queue->waiting.begin(); // no timer to wait with
+			}
+
+			++(it->group ? queue->groups : queue->lights);
+			return it;
+		}
+
+		void finished(bridge_queue* queue, const std::vector<size_t>& items, std::uint32_t asked, int status, json::value doc)
+		{
+			auto result = command_result(asked, status, doc);
 
-	void manager::do_update(const std::shared_ptr<shade::model::light_source>& source, const change_def& change)
+			bool last = false;
+			{
+				std::lock_guard<std::mutex> guard{ lock_ };
+				for (auto item : items) {
+					auto& out = result_.items[item];
+					if (!out.status || out.status / 100 == 2)
+						out.status = result.status; // keep the first failure
+					out.applied |= result.applied;
+					out.rejected |= result.rejected;
+					out.errors.insert(out.errors.end(), result.errors.begin(), result.errors.end());
+				}
+				--queue->in_flight;
+				last = !--outstanding_;
+			}
+
+			pump(queue);
+			if (last)
+				finish();
+		}
+
+		void finish()
+		{
+			for (auto const& item : result_.items) {
+				if (!item.ok() && (item.status || !item.superseded))
+					++result_.failed;
+			}
+
+			if (request_) {
+				storage_listener storage{ view_ };
+				for (size_t item = 0; item < touched_.size(); ++item) {
+					auto& bridge = touched_[item].bridge;
+					if (!bridge)
+						continue;
+					auto& result = result_.items[item];
+					auto rejected = all_fields;
+					if (result.status / 100 == 2)
+						rejected = result.rejected;
+					else if (!result.status && result.superseded)
+						rejected = 0; // never sent, nothing to undo
+					view_->bridge_settled(bridge, request_, touched_[item].ids, rejected,
+						&storage, listener_->bridge_listener(bridge));
+				}
+			}
+
+			if (done_)
+				done_(result_);
+		}
+	};
+
+	// Every light to change is listed, then the planner decides which
+	// of them can go to the bridge as a single group action.
+	void manager::update(const change_list& changes, onbatch done)
 	{
-		auto bridge = source->bridge();
-		std::string res{ source->is_group() ? "/groups/" : "/lights/" };
-		res.append(source->index());
-		res.append(source->is_group() ? "/action" : "/state");
+		auto work = std::make_shared<batch>(changes.size(), net_, budget_, std::move(done));
+
+		struct bridge_targets {
+			std::vector<model::plan_target> lights;
+			std::unordered_map<const model::light*, std::vector<std::pair<size_t, size_t>>> items; // (item, state)
+			batch::bridge_queue* queue = nullptr;
+		};
+
+		auto resource = [](const model::light_source& source) {
+			std::string res{ source.is_group() ? "/groups/" : "/lights/" };
+			res.append(source.index().str());
+			res.append(source.is_group() ? "/action" : "/state");
+			return res;
+		};
+
+		// equal changes share one body, rendered once
+		std::vector<const change_def*> distinct;
+		auto state_of = [&](const change_def& change) {
+			auto it = std::find_if(distinct.begin(), distinct.end(), [&](const change_def* known) { return *known == change; });
+			if (it != distinct.end())
+				return size_t(it - distinct.begin());
+			distinct.push_back(&change);
+			return work->body(change);
+		};
+
+		{
+			auto lock = view_.lock();
+
+			std::unordered_map<std::shared_ptr<model::bridge>, model::patch_list> patches;
+			auto request = optimistic_ ? ++requests_ : 0;
+			if (request)
+				work->optimistic(&view_, listener_, request);
+
+			std::unordered_map<std::shared_ptr<model::bridge>, bridge_targets> targets;
+			for (size_t item = 0; item < changes.size(); ++item) {
+				auto& source = changes[item].first;
+				auto bridge = source->bridge();
+				if (!bridge)
+					continue;
+
+				auto state = state_of(changes[item].second);
+				auto& target = targets[bridge];
+				if (!target.queue)
+					target.queue = work->queue(bridge->logged(view_.browser()));
+
+				if (request) {
+					auto patch = changes[item].second.patch();
+					if (patch.fields) {
+						auto& list = patches[bridge];
+						std::vector<model::atom> ids{ source->id() };
+						list.push_back({ source, patch });
+						if (source->is_group()) {
+							for (auto const& light : std::static_pointer_cast<model::group>(source)->lights()) {
+								list.push_back({ light, patch });
+								ids.push_back(light->id());
+							}
+						}
+						work->touched(item, bridge, std::move(ids));
+					}
+				}
+
+				if (!source->is_group()) {
+					auto light = std::static_pointer_cast<model::light>(source);
+					target.lights.push_back({ light, state });
+					target.items[light.get()].push_back({ item, state });
+					continue;
+				}
+
+				auto group = std::static_pointer_cast<model::group>(source);
+				if (group->lights().empty()) {
+					work->push(target.queue, { resource(*group), state, { item }, true });
+					continue;
+				}
+
+				for (auto const& light : group->lights()) {
+					target.lights.push_back({ light, state });
+					target.items[light.get()].push_back({ item, state });
+				}
+			}
+
+			for (auto const& pair : targets) {
+				auto& target = pair.second;
+
+				// as in the planner, the last state asked for a light wins
+				for (auto const& light : target.items) {
+					auto last = light.second.back().second;
+					for (auto const& asked : light.second) {
+						if (asked.second != last)
+							work->superseded(asked.first, light.first->id());
+					}
+				}
+
+				for (auto const& command : model::plan_commands(target.lights, pair.first->groups(), budget_)) {
+					std::vector<size_t> items;
+					auto add = [&](const model::light* light) {
+						auto it = target.items.find(light);
+						if (it == target.items.end())
+							return;
+						for (auto const& asked : it->second) {
+							if (asked.second == command.state)
+								items.push_back(asked.first);
+						}
+					};
+
+					if (command.source->is_group()) {
+						for (auto const& light : std::static_pointer_cast<model::group>(command.source)->lights())
+							add(light.get());
+					} else
+						add(static_cast<const model::light*>(command.source.get()));
+
+					std::sort(items.begin(), items.end());
+					items.erase(std::unique(items.begin(), items.end()), items.end());
+					work->push(target.queue, { resource(*command.source), command.state, std::move(items), command.source->is_group() });
+				}
+			}
+
+			// the model changes before anything is sent, so no reply can
+			// come back ahead of its request
+			storage_listener storage{ &view_ };
+			for (auto const& pair : patches)
+				view_.bridge_pending(pair.first, request, pair.second, &storage, listener_->bridge_listener(pair.first));
+		}
 
-		bridge->logged(view_.browser()).put(
-			res,
-			change.opts_.to_string(),
-			io::make_json_client([](auto, auto) {})
-		);
+		work->start();
 	}
 }
@@ -0,0 +1,57 @@
+#include <shade/model/arena.h>
+
+namespace shade { namespace model {
+	arena::block*& arena::head(size_t size)
+	{
+		for (auto& list : free_) {
+			if (list.size == size)
+				return list.head;
+		}
+
+		free_.push_back({ size, nullptr });
+		return free_.back().head;
+	}
+
+	void* arena::allocate(size_t size)
+	{
+		size = round_up(size);
+		if (size > max_block)
+			return ::operator new(size);
+
+		std::lock_guard<std::mutex> guard{ lock_ };
+
+		auto& list = head(size);
+		if (list) {
+			auto ptr = list;
+			list = ptr->next;
+			return ptr;
+		}
+
+		if (left_ < size) {
+			slabs_.emplace_back(new char[slab_size]);
+			current_ = slabs_.back().get();
+			left_ = slab_size;
+		}
+
+		auto ptr = current_;
+		current_ += size;
+		left_ -= size;
+		return ptr;
+	}
+
+	void arena::deallocate(void* ptr, size_t size)
+	{
+		size = round_up(size);
+		if (size > max_block) {
+			::operator delete(ptr);
+			return;
+		}
+
+		std::lock_guard<std::mutex> guard{ lock_ };
+
+		auto& list = head(size);
+		auto item = static_cast<block*>(ptr);
+		item->next = list;
+		list = item;
+	}
+} }
@@ -0,0 +1,33 @@
+#include <shade/model/atom.h>
+
+namespace shade { namespace model {
+	const std::string& atom::str() const
+	{
+		static const std::string empty;
+		return value_ ? *value_ : empty;
+	}
+
+	atom atom_table::intern(const std::string& value)
+	{
+		if (value.empty())
+			return {};
+
+		std::lock_guard<std::mutex> guard{ lock_ };
+		return atom{ &*strings_.insert(value).first };
+	}
+
+	atom atom_table::find(const std::string& value) const
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		auto it = strings_.find(value);
+		if (it == strings_.end())
+			return {};
+		return atom{ &*it };
+	}
+
+	size_t atom_table::size() const
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		return strings_.size();
+	}
+} }
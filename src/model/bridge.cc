@@ -1,6 +1,5 @@
 #include <shade/model/bridge.h>
 #include <shade/hue_data.h>
-#include <shade/listener.h>
 #include "json.h"
 #include <algorithm>
 #include <cstdio>
@@ -24,7 +23,7 @@ namespace shade { namespace model {
 	using std::begin;
 	using std::end;
 
-	struct lights_environment : json::named_translator, json::inplace_translator
+	struct sources_translator : json::named_translator, json::inplace_translator
 	{
 		std::string empty_;
 		const std::string& name() const override { return empty_; }
@@ -34,28 +33,51 @@ namespace shade { namespace model {
 		inplace_translator* inplace() override { return this; }
 		void pack(json::map& out, const void* ctx, json::ctx_env& env) override
 		{
-			auto& lights = static_cast<const bridge*>(ctx)->lights();
-			env["lights"] = (void*)(const void*)&lights;
+			auto& bridge = *static_cast<const model::bridge*>(ctx);
+			if (bridge.stored_) {
+				for (auto const& pair : *bridge.stored_)
+					out.add(pair.first, pair.second);
+				return;
+			}
+
+			if (!bridge.lights_.empty())
+				out.add("lights", json::pack(bridge.lights_, env));
+			if (!bridge.groups_.empty())
+				out.add("groups", json::pack(bridge.groups_, env));
 		}
 
-		bool unpack(const json::map& out, void* ctx, json::ctx_env& env) override
+		// Only keeps the JSON of the sources; they are unpacked when the
+		// bridge is hydrated.
+		bool unpack(const json::map& in, void* ctx, json::ctx_env& env) override
 		{
-			auto& lights = static_cast<bridge*>(ctx)->lights();
-			env["lights"] = (void*)&lights;
+			auto& bridge = *static_cast<model::bridge*>(ctx);
+			bridge.lights_.clear();
+			bridge.groups_.clear();
+			bridge.reindex();
+
+			json::map stored;
+			for (auto key : { "lights", "groups" }) {
+				auto it = in.find(key);
+				if (it != in.end())
+					stored.add(it->first, it->second);
+			}
+			bridge.stored_ = stored.size() ? std::make_shared<const json::map>(std::move(stored)) : nullptr;
 			return true;
 		}
 	};
 
-	bridge::bridge(const std::string& id, io::http* browser)
+	bridge::bridge(const std::string& id, io::http* browser, std::shared_ptr<atom_table> atoms)
 		: id_{ id }
 		, browser_{ browser }
+		, atoms_{ std::move(atoms) }
 	{
 	}
 
-	void bridge::from_storage(const std::string& id, io::http* browser)
+	void bridge::from_storage(const std::string& id, io::http* browser, std::shared_ptr<atom_table> atoms)
 	{
 		id_ = id;
 		browser_ = browser;
+		atoms_ = std::move(atoms);
 	}
 
 	void bridge::set_host(const std::string& name)
@@ -72,192 +94,337 @@ namespace shade { namespace model {
 		hosts_.push_back(current_ = std::make_shared<model::host>(name));
 	}
 
+	const std::shared_ptr<const io::endpoint>& bridge::endpoint() const
+	{
+		if (!endpoint_ || endpoint_->base() != hw_.base)
+			endpoint_ = std::make_shared<io::endpoint>(hw_.base);
+		return endpoint_;
+	}
+
+	const io::connection& bridge::logged(io::http* browser) const
+	{
+		auto& username = host().username();
+		auto& where = endpoint();
+		if (logged_.browser() != browser || logged_.where() != where || logged_as_ != username) {
+			logged_ = unlogged(browser).logged(username);
+			logged_as_ = username;
+		}
+		return logged_;
+	}
+
 	void bridge::prepare(json::struct_translator& tr)
 	{
 		using my_type = bridge;
 		tr.PRIV_PROP(hw);
-		tr.OPT_PRIV_PROP(lights);
-		tr.add(std::make_unique<lights_environment>());
-		tr.OPT_PRIV_PROP(groups);
+		tr.add(std::make_unique<sources_translator>());
 		tr.OPT_PRIV_PROP(hosts);
 	}
 
-	class listener_proxy : public listener::bridge {
-		listener::bridge* listener_;
-		model::bridge* braces_;
-		bool started_ = false;
-	public:
-		listener_proxy(listener::bridge* listener, model::bridge* braces)
-			: listener_{ listener }
-			, braces_{ braces }
-		{
-		}
+	void bridge::hydrate()
+	{
+		if (!stored_)
+			return;
 
-		~listener_proxy()
-		{
-			if (started_)
-				listener_->update_end(braces_->shared_from_this());
+		auto stored = std::move(stored_);
+		json::ctx_env env;
+		env["atoms"] = atoms_.get();
+		env["arena"] = (void*)&arena_;
+		auto it = stored->find("lights");
+		if (it == stored->end() || !json::unpack(lights_, it->second, env))
+			lights_.clear();
+
+		env["lights"] = (void*)&lights_;
+		it = stored->find("groups");
+		if (it == stored->end() || !json::unpack(groups_, it->second, env))
+			groups_.clear();
+
+		auto self = shared_from_this();
+		for (auto& source : lights_) {
+			source->bridge(self);
+			source->attach(light_states_);
+		}
+		for (auto& source : groups_) {
+			source->bridge(self);
+			source->attach(group_states_);
 		}
+		reindex();
+	}
 
-		void update_start(const std::shared_ptr<model::bridge>&) override {}
+	template <typename Source>
+	static inline void index_sources(const vector_shared<Source>& sources, source_index& index)
+	{
+		index.clear();
+		index.reserve(sources.size());
+		for (size_t i = 0; i < sources.size(); ++i)
+			index[sources[i]->id()] = i;
+	}
 
-		void source_added(const std::shared_ptr<model::light_source>& source) override
-		{
-			if (!started_)
-				listener_->update_start(braces_->shared_from_this());
-			started_ = true;
-			listener_->source_added(source);
-		}
+	void bridge::reindex()
+	{
+		index_sources(lights_, light_index_);
+		index_sources(groups_, group_index_);
+	}
 
-		void source_removed(const std::shared_ptr<model::light_source>& source) override
-		{
-			if (!started_)
-				listener_->update_start(braces_->shared_from_this());
-			started_ = true;
-			listener_->source_removed(source);
+	bridge_snapshot bridge::snapshot() const
+	{
+		bridge_snapshot out;
+		out.lights.reserve(lights_.size());
+		for (auto const& source : lights_)
+			out.lights.push_back(source->values());
+		out.groups.reserve(groups_.size());
+		for (auto const& source : groups_)
+			out.groups.push_back(source->values());
+		return out;
+	}
+
+	bool bridge::apply(bridge_diff& diff, change_set& changes)
+	{
+		hydrate();
+		changes.bridge = shared_from_this();
+
+		// groups must be visited even if the lights already changed
+		auto lights_changed = apply_lights(diff, changes);
+		auto groups_changed = apply_groups(diff, changes);
+		return lights_changed || groups_changed;
+	}
+
+	template <typename Source>
+	static inline std::shared_ptr<Source>* find_source(vector_shared<Source>& sources, const source_index& index, atom id)
+	{
+		auto it = index.find(id);
+		if (it == index.end())
+			return nullptr;
+		return &sources[it->second];
+	}
+
+	// Removed sources are taken out in a single pass, which keeps the
+	// positions of the others in order for the index.
+	template <typename Source>
+	static bool remove_sources(vector_shared<Source>& sources, source_index& index, const std::vector<atom>& ids, change_set& changes)
+	{
+		bool removed = false;
+		for (auto id : ids) {
+			auto it = index.find(id);
+			if (it == index.end())
+				continue;
+			auto source = std::move(sources[it->second]);
+			index.erase(it);
+			removed = true;
+			changes.removed(source, source->values());
 		}
 
-		void source_changed(const std::shared_ptr<model::light_source>& source) override
-		{
-			if (!started_)
-				listener_->update_start(braces_->shared_from_this());
-			started_ = true;
-			listener_->source_changed(source);
+		if (removed) {
+			sources.erase(std::remove(begin(sources), end(sources), nullptr), end(sources));
+			index_sources(sources, index);
 		}
+		return removed;
+	}
 
-		void update_end(const std::shared_ptr<model::bridge>&) override {}
-	};
+	bool bridge::pend(std::uint64_t request, const patch_list& targets, change_set& changes)
+	{
+		if (targets.empty())
+			return false;
+
+		hydrate();
+
+		// a source listed twice is patched in place, so the later patch
+		// goes on top and, as in the planner, the last one wins
+		bridge_diff diff;
+		std::unordered_map<atom, size_t> listed;
+		for (auto const& target : targets) {
+			auto& source = target.first;
+			auto& patch = target.second;
+			auto& list = source->is_group() ? diff.changed_groups : diff.changed_lights;
+			auto it = listed.find(source->id());
+			if (it == listed.end()) {
+				it = listed.emplace(source->id(), list.size()).first;
+				list.push_back(source->values());
+			}
+			auto& values = list[it->second];
 
-	class listener_nil : public listener::bridge {
-	public:
-		void update_start(const std::shared_ptr<model::bridge>&) override {};
-		void source_added(const std::shared_ptr<model::light_source>&) override {};
-		void source_removed(const std::shared_ptr<model::light_source>&) override {};
-		void source_changed(const std::shared_ptr<model::light_source>&) override {};
-		void update_end(const std::shared_ptr<model::bridge>&) override {};
-	};
+			auto& entry = pending_[values.id];
+			entry.before.take(values, patch.fields & ~entry.before.fields);
+			patch.apply(values);
+			entry.request = request;
+			entry.expected.take(values, patch.fields);
+		}
+		return apply(diff, changes);
+	}
 
-	bool bridge::bridge_lights(
-		std::unordered_map<std::string, hue::light> lights,
-		std::unordered_map<std::string, hue::group> groups,
-		listener::bridge* listener)
+	// A newer request for the same source settles it instead.
+	bool bridge::settle(std::uint64_t request, const std::vector<atom>& ids, std::uint32_t rejected, change_set& changes)
 	{
-		for (auto& group : groups) {
-			for (auto& lightref : group.second.lights) {
-				auto it = lights.find(lightref);
-				if (it == lights.end()) {
-					lightref.clear();
+		bridge_diff diff;
+		for (auto id : ids) {
+			auto it = pending_.find(id);
+			if (it == pending_.end() || it->second.request != request)
+				continue;
+
+			auto undo = it->second.before;
+			undo.fields &= it->second.expected.fields & rejected;
+			if (undo.fields) {
+				auto light = find_source(lights_, light_index_, id);
+				if (light) {
+					auto values = (*light)->values();
+					undo.apply(values);
+					diff.changed_lights.push_back(std::move(values));
+				} else {
+					auto group = find_source(groups_, group_index_, id);
+					if (group) {
+						auto values = (*group)->values();
+						undo.apply(values);
+						diff.changed_groups.push_back(std::move(values));
+					}
 				}
-				else
-					lightref = it->second.uniqueid;
 			}
-		}
 
-		listener_proxy proxy{ listener, this };
-		listener_nil nil;
-		auto ptr = listener ? (listener::bridge*)&proxy : &nil;
+			pending_.erase(it);
+		}
 
-		return update_lights(std::move(lights), ptr) || update_groups(std::move(groups), ptr);
+		if (diff.empty())
+			return false;
+		return apply(diff, changes);
 	}
 
-	bool bridge::update_lights(std::unordered_map<std::string, hue::light> lights, listener::bridge* listener)
+	// The bridge may still report the values from before the command;
+	// those are not news. Once it reports what was asked, the source is
+	// no longer pending.
+	void bridge::reconcile(bridge_diff& diff)
 	{
-		bool needs_update = false;
-		vector_shared<light> still_existing;
-		for (auto const& source : lights_) {
-			auto const& id = source->id();
-			auto it = std::find_if(begin(lights), end(lights), [&id](const auto& pair) {
-				return pair.second.uniqueid == id;
-			});
-			if (it == end(lights)) {
-				listener->source_removed(source);
-				continue;
+		if (pending_.empty())
+			return;
+
+		for (auto id : diff.removed_lights)
+			pending_.erase(id);
+		for (auto id : diff.removed_groups)
+			pending_.erase(id);
+
+		auto mask = [&](std::vector<source_values>& list) {
+			for (auto& values : list) {
+				auto it = pending_.find(values.id);
+				if (it == pending_.end())
+					continue;
+
+				auto asked = values;
+				it->second.expected.apply(asked);
+				if (asked == values)
+					pending_.erase(it);
+				else
+					values = std::move(asked);
 			}
-			auto updated = source->update(it->first, std::move(it->second));
-			if (updated)
-				listener->source_changed(source);
-			needs_update |= updated;
-			still_existing.push_back(source);
-		}
+		};
 
-		for (auto const& in : lights) {
-			auto const& id = in.second.uniqueid;
-			if (id.empty())
+		mask(diff.changed_lights);
+		mask(diff.changed_groups);
+	}
+
+	// The diff was taken against a snapshot; a source added or removed
+	// since then is looked up again, instead of trusting the diff's
+	// idea of what is already there.
+	bool bridge::apply_lights(bridge_diff& diff, change_set& changes)
+	{
+		bool needs_update = remove_sources(lights_, light_index_, diff.removed_lights, changes);
+
+		for (auto const& values : diff.changed_lights) {
+			auto it = find_source(lights_, light_index_, values.id);
+			if (!it) {
+				diff.added_lights.push_back(values);
 				continue;
+			}
 
-			auto it = std::find_if(begin(lights_), end(lights_), [&id](const auto& ptr) {
-				return ptr->id() == id;
-			});
+			auto& source = *it;
+			auto before = source->values();
+			if (source->update(values)) {
+				needs_update = true;
+				changes.changed(source, std::move(before), values);
+			}
+		}
 
-			if (it != end(lights_))
+		for (auto& values : diff.added_lights) {
+			auto it = find_source(lights_, light_index_, values.id);
+			if (it) {
+				auto& source = *it;
+				auto before = source->values();
+				if (source->update(values)) {
+					needs_update = true;
+					changes.changed(source, std::move(before), values);
+				}
 				continue;
+			}
 
 			auto new_source = model::light::make(
+				arena_,
 				shared_from_this(),
-				in.first,
-				std::move(in.second.uniqueid),
-				std::move(in.second.name),
-				std::move(in.second.modelid),
-				in.second.state.on,
-				in.second.state.bri,
-				model::color_mode::from_json(in.second.state)
+				light_states_,
+				values.index,
+				values.id,
+				std::move(values.name),
+				values.type,
+				values.on,
+				values.bri,
+				values.value
 			);
 			needs_update = true;
-			still_existing.push_back(new_source);
-			listener->source_added(new_source);
+			light_index_[new_source->id()] = lights_.size();
+			lights_.push_back(new_source);
+			changes.added(new_source, new_source->values());
 		}
 
-		std::swap(lights_, still_existing);
 		return needs_update;
 	}
 
-	bool bridge::update_groups(std::unordered_map<std::string, hue::group> groups, listener::bridge* listener)
+	bool bridge::apply_groups(bridge_diff& diff, change_set& changes)
 	{
-		bool needs_update = false;
-		vector_shared<group> still_existing;
-		for (auto const& source : groups_) {
-			auto const& id = source->id();
-			auto it = std::find_if(begin(groups), end(groups), [&id](const auto& pair) {
-				return "group/" + pair.first == id;
-			});
-			if (it == end(groups)) {
-				listener->source_removed(source);
+		bool needs_update = remove_sources(groups_, group_index_, diff.removed_groups, changes);
+
+		for (auto const& values : diff.changed_groups) {
+			auto it = find_source(groups_, group_index_, values.id);
+			if (!it) {
+				diff.added_groups.push_back(values);
 				continue;
 			}
-			auto updated = source->update(it->first, std::move(it->second), lights_);
-			if (updated)
-				listener->source_changed(source);
-			needs_update |= updated;
-			still_existing.push_back(source);
-		}
 
-		for (auto const& in : groups) {
-			auto it = std::find_if(begin(groups_), end(groups_), [id = "group/" + in.first](const auto& ptr) {
-				return ptr->id() == id;
-			});
+			auto& source = *it;
+			auto before = source->values();
+			if (source->update(values, lights_)) {
+				needs_update = true;
+				changes.changed(source, std::move(before), source->values());
+			}
+		}
 
-			if (it != end(groups_))
+		for (auto& values : diff.added_groups) {
+			auto it = find_source(groups_, group_index_, values.id);
+			if (it) {
+				auto& source = *it;
+				auto before = source->values();
+				if (source->update(values, lights_)) {
+					needs_update = true;
+					changes.changed(source, std::move(before), source->values());
+				}
 				continue;
+			}
 
 			auto new_source = model::group::make(
+				arena_,
 				shared_from_this(),
-				in.first,
-				"group/" + in.first,
-				std::move(in.second.name),
-				std::move(in.second.type),
-				std::move(in.second.klass),
-				in.second.state.all_on,
-				in.second.state.any_on,
-				in.second.action.bri,
-				model::color_mode::from_json(in.second.action),
-				model::group::referenced(in.second.lights, lights_)
+				group_states_,
+				values.index,
+				values.id,
+				std::move(values.name),
+				values.type,
+				std::move(values.klass),
+				values.on,
+				values.some,
+				values.bri,
+				values.value,
+				model::group::referenced(values.lights, lights_)
 			);
 			needs_update = true;
-			still_existing.push_back(new_source);
-			listener->source_added(new_source);
+			group_index_[new_source->id()] = groups_.size();
+			groups_.push_back(new_source);
+			changes.added(new_source, new_source->values());
 		}
 
-		std::swap(groups_, still_existing);
 		return needs_update;
 	}
 } }
@@ -0,0 +1,40 @@
+#include <shade/model/change_set.h>
+
+namespace shade { namespace model {
+	static constexpr std::uint32_t all_fields = (field_lights << 1) - 1;
+
+	std::uint32_t changed_fields(const source_values& before, const source_values& after)
+	{
+		std::uint32_t out = 0;
+#define FIELD(name) if (!(before.name == after.name)) out |= field_ ## name
+		FIELD(index);
+		FIELD(id);
+		FIELD(name);
+		FIELD(type);
+		FIELD(on);
+		FIELD(bri);
+		FIELD(value);
+		FIELD(klass);
+		FIELD(some);
+#undef FIELD
+		if (!same_lights(before.lights, after.lights))
+			out |= field_lights;
+		return out;
+	}
+
+	void change_set::added(const std::shared_ptr<light_source>& source, source_values after)
+	{
+		changes.push_back({ source_change::added, all_fields, {}, std::move(after), source });
+	}
+
+	void change_set::removed(const std::shared_ptr<light_source>& source, source_values before)
+	{
+		changes.push_back({ source_change::removed, all_fields, std::move(before), {}, source });
+	}
+
+	void change_set::changed(const std::shared_ptr<light_source>& source, source_values before, source_values after)
+	{
+		auto fields = changed_fields(before, after);
+		changes.push_back({ source_change::changed, fields, std::move(before), std::move(after), source });
+	}
+} }
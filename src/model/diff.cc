@@ -0,0 +1,121 @@
+#include <shade/model/diff.h>
+#include <shade/hue_data.h>
+#include <algorithm>
+#include <unordered_map>
+
+namespace shade { namespace model {
+	bool same_lights(const std::vector<atom>& lhs, const std::vector<atom>& rhs)
+	{
+		if (lhs.size() != rhs.size())
+			return false;
+
+		for (auto id : lhs) {
+			if (std::find(rhs.begin(), rhs.end(), id) == rhs.end())
+				return false;
+		}
+		return true;
+	}
+
+	bool source_values::operator == (const source_values& rhs) const
+	{
+		return index == rhs.index
+			&& id == rhs.id
+			&& name == rhs.name
+			&& type == rhs.type
+			&& on == rhs.on
+			&& bri == rhs.bri
+			&& value == rhs.value
+			&& klass == rhs.klass
+			&& some == rhs.some
+			&& same_lights(lights, rhs.lights);
+	}
+
+	bool bridge_diff::empty() const
+	{
+		return added_lights.empty()
+			&& changed_lights.empty()
+			&& removed_lights.empty()
+			&& added_groups.empty()
+			&& changed_groups.empty()
+			&& removed_groups.empty();
+	}
+
+	template <typename Incoming>
+	static void diff_sources(const std::vector<source_values>& current, Incoming& incoming,
+		std::vector<source_values>& added, std::vector<source_values>& changed, std::vector<atom>& removed)
+	{
+		for (auto const& source : current) {
+			auto it = incoming.find(source.id);
+			if (it == incoming.end()) {
+				removed.push_back(source.id);
+				continue;
+			}
+
+			if (it->second != source)
+				changed.push_back(std::move(it->second));
+			incoming.erase(it);
+		}
+
+		added.reserve(incoming.size());
+		for (auto& pair : incoming)
+			added.push_back(std::move(pair.second));
+	}
+
+	bridge_diff compute_diff(const bridge_snapshot& current, hue::sources& sources, atom_table& atoms)
+	{
+		bridge_diff out;
+
+		std::unordered_map<atom, source_values> lights;
+		lights.reserve(sources.lights.size());
+		for (auto& pair : sources.lights) {
+			auto& json = pair.second;
+			auto id = atoms.intern(json.uniqueid);
+			if (id.empty())
+				continue;
+
+			auto& values = lights[id];
+			values.index = atoms.intern(pair.first);
+			values.id = id;
+			values.name = std::move(json.name);
+			values.type = atoms.intern(json.modelid);
+			values.on = json.state.on;
+			values.bri = mode::clamp(json.state.bri);
+			values.value = color_mode::from_json(json.state);
+		}
+
+		std::unordered_map<atom, source_values> groups;
+		groups.reserve(sources.groups.size());
+		std::string key_id = "group/";
+		for (auto& pair : sources.groups) {
+			auto& json = pair.second;
+			key_id.resize(6);
+			key_id.append(pair.first);
+			auto id = atoms.intern(key_id);
+
+			auto& values = groups[id];
+			values.index = atoms.intern(pair.first);
+			values.id = id;
+			values.name = std::move(json.name);
+			values.type = atoms.intern(json.type);
+			values.on = json.state.all_on;
+			values.bri = mode::clamp(json.action.bri);
+			values.value = color_mode::from_json(json.action);
+			values.klass = std::move(json.klass);
+			values.some = json.state.any_on;
+
+			values.lights.reserve(json.lights.size());
+			for (auto const& ref : json.lights) {
+				auto it = sources.lights.find(ref);
+				if (it == sources.lights.end())
+					continue;
+				auto light = atoms.find(it->second.uniqueid);
+				if (!light.empty() && lights.count(light))
+					values.lights.push_back(light);
+			}
+		}
+
+		diff_sources(current.lights, lights, out.added_lights, out.changed_lights, out.removed_lights);
+		diff_sources(current.groups, groups, out.added_groups, out.changed_groups, out.removed_groups);
+		return out;
+	}
+} }
@@ -1,5 +1,5 @@
 #include <shade/model/group.h>
-#include <shade/hue_data.h>
+#include <shade/model/diff.h>
 #include <algorithm>
 #include "model/json.h"
 
@@ -21,7 +21,7 @@ namespace shade { namespace model {
 		{
 			json::vector v;
 			for (auto & ref : static_cast<const model::group*>(ctx)->lights())
-				v.add(ref->id());
+				v.add(ref->id().str());
 			return v;
 		}
 		bool unpack(const json::value& v, void* ctx, json::ctx_env& env) override
@@ -39,15 +39,24 @@ namespace shade { namespace model {
 
 			auto& all = *static_cast<const vector_shared<light>*>(it->second);
 
+			it = env.find("atoms");
+			if (it == env.end() || !it->second) {
+				clean(ctx);
+				return true;
+			}
+
+			auto& atoms = *static_cast<const atom_table*>(it->second);
+
 			vector_shared<light> out;
 			json::vector in{ v };
 			out.reserve(in.size());
 
 			for (auto const& ref : in) {
-				auto& sref = ref.as<json::STRING>();
-				std::shared_ptr<light> ptr;
+				auto id = atoms.find(ref.as<json::STRING>());
+				if (id.empty())
+					continue;
 				for (auto& light : all) {
-					if (light->id() == sref) {
+					if (light->id() == id) {
 						out.push_back(light);
 						break;
 					}
@@ -77,38 +86,39 @@ namespace shade { namespace model {
 		return true;
 	}
 
-#define UPDATE_SOURCE(name, data) \
-	if (name() != data) { \
-		updated = true; \
-		name(data); \
+	source_values group::values() const
+	{
+		auto out = light_source::values();
+		out.klass = klass_;
+		out.some = some_;
+		out.lights.reserve(lights_.size());
+		for (auto const& light : lights_)
+			out.lights.push_back(light->id());
+		return out;
 	}
-	bool group::update(const std::string& key, hue::group json, const vector_shared<light>& resource)
+
+	bool group::update(const source_values& values, const vector_shared<light>& resource)
 	{
-		bool updated = false;
-		auto mode = color_mode::from_json(json.action);
-		auto brightness = mode::clamp(json.action.bri);
-		auto key_id = "group/" + key;
-		auto refs = referenced(json.lights, resource);
-
-		UPDATE_SOURCE(index, key);
-		UPDATE_SOURCE(id, key_id);
-		UPDATE_SOURCE(name, json.name);
-		UPDATE_SOURCE(type, json.type);
-		UPDATE_SOURCE(on, json.state.all_on);
-		UPDATE_SOURCE(bri, brightness);
-		UPDATE_SOURCE(value, mode);
-
-		UPDATE_SOURCE(klass, json.klass);
-		UPDATE_SOURCE(some, json.state.any_on);
-
-		if (!equal(lights(), refs)) {
+		bool updated = light_source::update(values);
+
+		if (klass_ != values.klass) {
+			updated = true;
+			klass_ = values.klass;
+		}
+
+		if (some_ != values.some) {
+			updated = true;
+			some_ = values.some;
+		}
+
+		auto refs = referenced(values.lights, resource);
+		if (!equal(lights_, refs)) {
 			updated = true;
-			lights(refs);
+			lights_ = std::move(refs);
 		}
 
 		return updated;
 	}
-#undef UPDATE_SOURCE
 
 	void group::prepare(json::struct_translator& tr)
 	{
@@ -119,13 +129,13 @@ namespace shade { namespace model {
 		tr.add(std::make_unique<refs_translator>());
 	}
 
-	vector_shared<light> group::referenced(const std::vector<std::string>& lights, const vector_shared<light>& resource)
+	vector_shared<light> group::referenced(const std::vector<atom>& lights, const vector_shared<light>& resource)
 	{
 		vector_shared<model::light> refs;
 		refs.reserve(lights.size());
-		for (auto const& light : lights) {
+		for (auto id : lights) {
 			for (auto& ref : resource) {
-				if (ref->id() == light)
+				if (ref->id() == id)
 					refs.push_back(ref);
 			}
 		}
@@ -22,12 +22,12 @@ namespace shade { namespace model {
 		return true;
 	}
 
-	bool host::is_selected(const std::string& dev) const
+	bool host::is_selected(atom dev) const
 	{
 		return selected_.count(dev) > 0;
 	}
 
-	void host::switch_selection(const std::string& dev)
+	void host::switch_selection(atom dev)
 	{
 		auto sel = selected_.find(dev);
 		if (sel == selected_.end())
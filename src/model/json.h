@@ -2,6 +2,8 @@
 
 #include <json/json.hpp>
 #include <json/serdes.hpp>
+#include <shade/model/arena.h>
+#include <shade/model/atom.h>
 
 #define JSON_STATIC_DECL(name) \
 	template <> \
@@ -28,6 +30,26 @@
 #define ITEM_PROP(prop) ITEM_NAMED_PROP(#prop, prop)
 
 namespace json {
+	// Atoms are interned in the table the caller puts in env["atoms"]
+	template <>
+	struct translator<shade::model::atom> : base_translator {
+		value pack(const void* ctx, ctx_env& env) override
+		{
+			return static_cast<const shade::model::atom*>(ctx)->str();
+		}
+
+		bool unpack(const value& v, void* ctx, ctx_env& env) override
+		{
+			auto it = env.find("atoms");
+			if (it == env.end() || !it->second || !v.is<json::STRING>())
+				return false;
+
+			auto& atoms = *static_cast<shade::model::atom_table*>(it->second);
+			*static_cast<shade::model::atom*>(ctx) = atoms.intern(v.as<json::STRING>());
+			return true;
+		}
+	};
+
 	template <typename T>
 	struct translator<std::shared_ptr<T>> {
 		value pack(const void* ctx, ctx_env& env) const
@@ -53,7 +75,11 @@ namespace json {
 			if (!inner.unpack(v, &val, env))
 				return false;
 
-			ptr = std::make_shared<T>(std::move(val));
+			auto pool = env.find("arena");
+			if (pool == env.end())
+				ptr = std::make_shared<T>(std::move(val));
+			else
+				ptr = shade::model::allocate_shared<T>(*static_cast<std::shared_ptr<shade::model::arena>*>(pool->second), std::move(val));
 			return true;
 		}
 	};
@@ -1,6 +1,8 @@
 #include <shade/model/light_source.h>
+#include <shade/model/diff.h>
 #include <shade/hue_data.h>
 #include "model/json.h"
+#include <utility>
 
 namespace json {
 }
@@ -19,6 +21,8 @@ namespace shade { namespace model {
 				return false;
 
 			switch (mode_) {
+			case mode::empty:
+				return true;
 			case mode::hue_sat:
 				return hue_.hue == rhs.hue_.hue
 					&& hue_.sat == rhs.hue_.sat;
@@ -80,17 +84,156 @@ namespace shade { namespace model {
 		}
 	}
 
+	light_source::light_source()
+		: states_{ std::make_shared<state_table>() }
+		, row_{ states_->acquire() }
+	{
+	}
+
+	light_source::light_source(const std::shared_ptr<model::bridge>& owner, std::shared_ptr<state_table> states, atom idx, atom id, std::string name, atom type, bool on, int bri, color_mode value)
+		: idx_{ idx }
+		, id_{ id }
+		, name_{ std::move(name) }
+		, type_{ type }
+		, states_{ std::move(states) }
+		, row_{ states_->acquire() }
+		, owner_{ owner }
+	{
+		states_->on(row_, on);
+		states_->bri(row_, bri);
+		states_->value(row_, value);
+	}
+
+	light_source::light_source(const light_source& rhs)
+		: idx_{ rhs.idx_ }
+		, id_{ rhs.id_ }
+		, name_{ rhs.name_ }
+		, type_{ rhs.type_ }
+		, states_{ rhs.states_ }
+		, row_{ states_->acquire() }
+		, owner_{ rhs.owner_ }
+	{
+		states_->copy(row_, *rhs.states_, rhs.row_);
+	}
+
+	light_source::light_source(light_source&& rhs)
+		: idx_{ rhs.idx_ }
+		, id_{ rhs.id_ }
+		, name_{ std::move(rhs.name_) }
+		, type_{ rhs.type_ }
+		, states_{ std::move(rhs.states_) }
+		, row_{ rhs.row_ }
+		, owner_{ std::move(rhs.owner_) }
+	{
+		// the moved-from source stays usable, with a table of its own
+		rhs.states_ = std::make_shared<state_table>();
+		rhs.row_ = rhs.states_->acquire();
+	}
+
+	light_source& light_source::operator=(const light_source& rhs)
+	{
+		if (this == &rhs)
+			return *this;
+
+		idx_ = rhs.idx_;
+		id_ = rhs.id_;
+		name_ = rhs.name_;
+		type_ = rhs.type_;
+		owner_ = rhs.owner_;
+		if (!states_) {
+			states_ = rhs.states_;
+			row_ = states_->acquire();
+		}
+		states_->copy(row_, *rhs.states_, rhs.row_);
+		return *this;
+	}
+
+	light_source& light_source::operator=(light_source&& rhs)
+	{
+		if (this == &rhs)
+			return *this;
+
+		idx_ = rhs.idx_;
+		id_ = rhs.id_;
+		name_ = std::move(rhs.name_);
+		type_ = rhs.type_;
+		owner_ = std::move(rhs.owner_);
+
+		// the moved-from source keeps the row this one gives up
+		if (!states_) {
+			states_ = std::make_shared<state_table>();
+			row_ = states_->acquire();
+		}
+		std::swap(states_, rhs.states_);
+		std::swap(row_, rhs.row_);
+		return *this;
+	}
+
+	light_source::~light_source()
+	{
+		if (states_)
+			states_->release(row_);
+	}
+
+	void light_source::attach(const std::shared_ptr<state_table>& states)
+	{
+		if (states_ == states)
+			return;
+
+		auto row = states->acquire();
+		if (states_) {
+			states->copy(row, *states_, row_);
+			states_->release(row_);
+		}
+		states_ = states;
+		row_ = row;
+	}
+
 	bool light_source::operator == (const light_source& rhs) const
 	{
 		return id_ == rhs.id_
 			&& name_ == rhs.name_
 			&& type_ == rhs.type_
-			&& on_ == rhs.on_
-			&& brightness_ == rhs.brightness_
-			&& value_ == rhs.value_;
+			&& on() == rhs.on()
+			&& bri() == rhs.bri()
+			&& value() == rhs.value();
 	}
 
-	struct mode_translator : json::named_translator, json::inplace_translator
+	source_values light_source::values() const
+	{
+		source_values out;
+		out.index = idx_;
+		out.id = id_;
+		out.name = name_;
+		out.type = type_;
+		out.on = on();
+		out.bri = bri();
+		out.value = value();
+		return out;
+	}
+
+#define UPDATE_SOURCE(name, data) \
+	if (name() != data) { \
+		updated = true; \
+		name(data); \
+	}
+	bool light_source::update(const source_values& values)
+	{
+		bool updated = false;
+
+		UPDATE_SOURCE(index, values.index);
+		UPDATE_SOURCE(id, values.id);
+		UPDATE_SOURCE(name, values.name);
+		UPDATE_SOURCE(type, values.type);
+		UPDATE_SOURCE(on, values.on);
+		UPDATE_SOURCE(bri, values.bri);
+		UPDATE_SOURCE(value, values.value);
+
+		return updated;
+	}
+#undef UPDATE_SOURCE
+
+	struct state_translator : json::named_translator, json::inplace_translator
 	{
 		std::string empty_;
 		const std::string& name() const override { return empty_; }
@@ -100,7 +243,13 @@ namespace shade { namespace model {
 		inplace_translator* inplace() override { return this; }
 		void pack(json::map& out, const void* ctx, json::ctx_env& env) override
 		{
-			static_cast<const light_source*>(ctx)->value().visit(mode::combine(
+			auto& src = *static_cast<const light_source*>(ctx);
+			if (src.on())
+				out.add("on", true);
+			if (src.bri())
+				out.add("bri", src.bri());
+
+			src.value().visit(mode::combine(
 				[&](const mode::hue_sat& hue) { out.add("hue", hue.hue); out.add("sat", hue.sat); },
 				[&](const mode::xy& xy) { out.add("x", xy.x); out.add("y", xy.y); },
 				[&](const mode::ct& ct) { out.add("ct", ct.val); }
@@ -111,7 +260,13 @@ namespace shade { namespace model {
 		{
 			auto& src = *static_cast<light_source*>(ctx);
 
-			auto it1 = out.find("ct");
+			auto it1 = out.find("on");
+			src.on(it1 != out.end() && it1->second.as_bool());
+			it1 = out.find("bri");
+			src.bri(it1 != out.end() ? (int)it1->second.as_int() : 0);
+			src.value({});
+
+			it1 = out.find("ct");
 			if (it1 != out.end() && it1->second.is<json::INTEGER>()) {
 				src.value(mode::ct{
 					mode::clamp((int)it1->second.as<json::INTEGER>())
@@ -152,9 +307,7 @@ namespace shade { namespace model {
 		tr.PRIV_PROP(id);
 		tr.PRIV_PROP(name);
 		tr.PRIV_PROP(type);
-		tr.OPT_PRIV_PROP(on);
-		tr.OPT_NAMED_PROP("bri", brightness_);
-		tr.add(std::make_unique<mode_translator>());
+		tr.add(std::make_unique<state_translator>());
 	}
 
 } }
@@ -0,0 +1,24 @@
+#include <shade/model/pending.h>
+
+namespace shade { namespace model {
+	void source_patch::apply(source_values& values) const
+	{
+		if (fields & field_on)
+			values.on = on;
+		if (fields & field_bri)
+			values.bri = bri;
+		if (fields & field_value)
+			values.value = value;
+	}
+
+	void source_patch::take(const source_values& values, std::uint32_t fields)
+	{
+		this->fields |= fields;
+		if (fields & field_on)
+			on = values.on;
+		if (fields & field_bri)
+			bri = values.bri;
+		if (fields & field_value)
+			value = values.value;
+	}
+} }
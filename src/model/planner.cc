@@ -0,0 +1,103 @@
+#include <shade/model/planner.h>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace shade { namespace model {
+	static inline size_t windows(size_t count, size_t per_window)
+	{
+		if (!per_window)
+			per_window = 1;
+		return (count + per_window - 1) / per_window;
+	}
+
+	static inline std::pair<size_t, size_t> cost(size_t lights, size_t groups, const rate_budget& budget)
+	{
+		auto needed = std::max(windows(lights, budget.lights), windows(groups, budget.groups));
+		return { needed, lights + groups };
+	}
+
+	std::vector<planned_command> plan_commands(const std::vector<plan_target>& targets, const vector_shared<group>& groups, const rate_budget& budget)
+	{
+		// the last state asked for a light wins
+		std::unordered_map<const light*, size_t> wanted;
+		for (auto const& target : targets)
+			wanted[target.source.get()] = target.state;
+
+		struct candidate {
+			const std::shared_ptr<group>* source;
+			size_t state;
+		};
+
+		// a group may only be used, if it would not touch any other light
+		std::vector<candidate> candidates;
+		for (auto const& group : groups) {
+			auto& members = group->lights();
+			if (members.empty())
+				continue;
+
+			auto first = wanted.find(members.front().get());
+			if (first == wanted.end())
+				continue;
+
+			auto state = first->second;
+			auto usable = std::all_of(members.begin(), members.end(), [&](const auto& light) {
+				auto it = wanted.find(light.get());
+				return it != wanted.end() && it->second == state;
+			});
+			if (usable)
+				candidates.push_back({ &group, state });
+		}
+
+		std::vector<planned_command> out;
+		std::unordered_set<const light*> covered;
+		size_t light_commands = wanted.size();
+		size_t group_commands = 0;
+
+		while (!candidates.empty()) {
+			auto uncovered = [&](const candidate& item) {
+				auto& members = (*item.source)->lights();
+				return (size_t)std::count_if(members.begin(), members.end(), [&](const auto& light) {
+					return !covered.count(light.get());
+				});
+			};
+
+			// most new lights first, then the least overlap
+			auto best = candidates.begin();
+			auto best_count = uncovered(*best);
+			for (auto it = std::next(best); it != candidates.end(); ++it) {
+				auto count = uncovered(*it);
+				if (count > best_count || (count == best_count && (*it->source)->lights().size() < (*best->source)->lights().size())) {
+					best = it;
+					best_count = count;
+				}
+			}
+
+			if (!best_count)
+				break;
+
+			auto before = cost(light_commands, group_commands, budget);
+			auto after = cost(light_commands - best_count, group_commands + 1, budget);
+			if (!(after < before))
+				break;
+
+			light_commands -= best_count;
+			++group_commands;
+			for (auto const& light : (*best->source)->lights())
+				covered.insert(light.get());
+			out.push_back({ *best->source, best->state });
+			candidates.erase(best);
+		}
+
+		for (auto const& target : targets) {
+			auto ptr = target.source.get();
+			if (covered.count(ptr))
+				continue;
+			covered.insert(ptr);
+			out.push_back({ target.source, wanted[ptr] });
+		}
+
+		return out;
+	}
+} }
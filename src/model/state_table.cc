@@ -0,0 +1,78 @@
+#include <shade/model/state_table.h>
+
+namespace shade { namespace model {
+	state_table::handle state_table::acquire()
+	{
+		handle row;
+		if (!free_.empty()) {
+			row = free_.back();
+			free_.pop_back();
+		} else {
+			row = (handle)used_.size();
+			used_.push_back(0);
+			on_.push_back(0);
+			bri_.push_back(0);
+			mode_.push_back(mode::mode::empty);
+			hue_.push_back(0);
+			sat_.push_back(0);
+			ct_.push_back(0);
+			x_.push_back(0);
+			y_.push_back(0);
+		}
+
+		used_[row] = 1;
+		on_[row] = 0;
+		bri_[row] = 0;
+		mode_[row] = mode::mode::empty;
+		return row;
+	}
+
+	void state_table::release(handle row)
+	{
+		used_[row] = 0;
+		on_[row] = 0;
+		free_.push_back(row);
+	}
+
+	mode::color state_table::value(handle row) const
+	{
+		switch (mode_[row]) {
+		case mode::mode::hue_sat: return mode::hue_sat{ hue_[row], sat_[row] };
+		case mode::mode::ct: return mode::ct{ ct_[row] };
+		case mode::mode::xy: return mode::xy{ x_[row], y_[row] };
+		default: break;
+		}
+		return {};
+	}
+
+	void state_table::value(handle row, const mode::color& v)
+	{
+		mode_[row] = mode::mode::empty;
+		v.visit(mode::combine(
+			[&](const mode::hue_sat& hs) { mode_[row] = mode::mode::hue_sat; hue_[row] = hs.hue; sat_[row] = hs.sat; },
+			[&](const mode::ct& ct) { mode_[row] = mode::mode::ct; ct_[row] = ct.val; },
+			[&](const mode::xy& xy) { mode_[row] = mode::mode::xy; x_[row] = xy.x; y_[row] = xy.y; }
+		));
+	}
+
+	void state_table::copy(handle row, const state_table& src, handle src_row)
+	{
+		on_[row] = src.on_[src_row];
+		bri_[row] = src.bri_[src_row];
+		mode_[row] = src.mode_[src_row];
+		hue_[row] = src.hue_[src_row];
+		sat_[row] = src.sat_[src_row];
+		ct_[row] = src.ct_[src_row];
+		x_[row] = src.x_[src_row];
+		y_[row] = src.y_[src_row];
+	}
+
+	size_t state_table::count_on() const
+	{
+		// released rows have their on flag cleared, no need to check used_
+		size_t count = 0;
+		for (auto on : on_)
+			count += on;
+		return count;
+	}
+} }
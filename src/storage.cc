@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <cstdio>
 #include <memory>
+#include <mutex>
 
 namespace json {
 	JSON_STATIC_DECL(shade::model::bridge);
@@ -39,37 +40,57 @@ namespace shade { namespace storage {
 		return out;
 	}
 
-	void load(cache& view)
+	static std::mutex& file_lock()
+	{
+		static std::mutex lock;
+		return lock;
+	}
+
+	static json::value read_file()
 	{
+		std::lock_guard<std::mutex> guard{ file_lock() };
 		auto in = file::open(filename().c_str());
 		if (!in)
-			return;
+			return {};
+		return json::from_string(contents(in.get()));
+	}
 
+	void load(cache& view)
+	{
 		std::decay_t<decltype(view.bridges())> bridges;
 
-		auto object = json::from_string(contents(in.get()));
-		if (!json::unpack(bridges, object)) {
+		json::ctx_env env;
+		env["atoms"] = view.atoms().get();
+
+		auto object = read_file();
+		if (object.is<json::NULLPTR>())
+			return;
+
+		if (!json::unpack(bridges, object, env)) {
 			view.bridges({});
 			return;
 		}
 
 		for (auto& pair : bridges) {
 			pair.second->set_host(view.current_host());
-			pair.second->from_storage(pair.first, view.browser());
-			for (auto& source : pair.second->lights())
-				source->bridge(pair.second);
-			for (auto& source : pair.second->groups())
-				source->bridge(pair.second);
+			pair.second->from_storage(pair.first, view.browser(), view.atoms());
 		}
 
 		view.bridges(std::move(bridges));
 	}
 
+	// Bridges that were never hydrated write back the sources they
+	// were loaded with.
 	void store(const cache& view)
 	{
-		auto text = json::pack(view.bridges())
-			.to_string(json::value::options::indented());
+		json::value doc;
+		{
+			auto lock = view.lock();
+			doc = json::pack(view.bridges());
+		}
+		auto text = doc.to_string(json::value::options::indented());
 
+		std::lock_guard<std::mutex> guard{ file_lock() };
 		auto out = file::open(filename().c_str(), "w");
 		if (!out)
 			return;
@@ -0,0 +1,53 @@
+#include <shade/workers.h>
+
+namespace shade {
+	workers::workers(size_t threads, size_t capacity)
+		: capacity_{ capacity ? capacity : 1 }
+	{
+		if (!threads)
+			threads = 1;
+
+		threads_.reserve(threads);
+		for (size_t i = 0; i < threads; ++i)
+			threads_.emplace_back([this] { run(); });
+	}
+
+	workers::~workers()
+	{
+		{
+			std::lock_guard<std::mutex> guard{ lock_ };
+			done_ = true;
+		}
+		wake_.notify_all();
+		for (auto& thread : threads_)
+			thread.join();
+	}
+
+	bool workers::submit(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> guard{ lock_ };
+			if (done_ || jobs_.size() >= capacity_)
+				return false;
+			jobs_.push_back(std::move(job));
+		}
+		wake_.notify_one();
+		return true;
+	}
+
+	void workers::run()
+	{
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> guard{ lock_ };
+				wake_.wait(guard, [this] { return done_ || !jobs_.empty(); });
+				if (jobs_.empty())
+					return;
+				job = std::move(jobs_.front());
+				jobs_.pop_front();
+			}
+			job();
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#include <shade/manager.h>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+namespace {
+	using shade::change_def;
+	using namespace shade::model;
+
+	bool check(const char* name, const change_def& change, const char* expected)
+	{
+		auto& body = change.body();
+		auto ok = body == expected;
+		printf("%s: %s%s\n", name, body.c_str(), ok ? "" : " FAILED");
+		if (!ok)
+			printf("    expected: %s\n", expected);
+		return ok;
+	}
+
+	change_def xy(double x, double y)
+	{
+		return change_def{}.color(color_mode{ mode::xy{ x, y } });
+	}
+}
+
+int main()
+{
+	bool ok = true;
+	ok &= check("empty", change_def{}, "{}");
+	ok &= check("on", change_def{}.on(true), "{\"on\":true}");
+	ok &= check("off, bri", change_def{}.on(false).bri(254), "{\"on\":false,\"bri\":254}");
+	ok &= check("hue, sat", change_def{}.color(color_mode{ mode::hue_sat{ 65535, 0 } }), "{\"hue\":65535,\"sat\":0}");
+	ok &= check("ct", change_def{}.bri(1).color(color_mode{ mode::ct{ 366 } }), "{\"bri\":1,\"ct\":366}");
+	ok &= check("color replaced", change_def{}.color(color_mode{ mode::ct{ 153 } }).color(color_mode{ mode::xy{ 0.5, 0.25 } }), "{\"xy\":[0.5,0.25]}");
+
+	ok &= check("xy", xy(0.3127, 0.329), "{\"xy\":[0.3127,0.329]}");
+	ok &= check("xy whole", xy(1, 0), "{\"xy\":[1,0]}");
+	ok &= check("xy tenth", xy(0.1, 0.7), "{\"xy\":[0.1,0.7]}");
+	ok &= check("xy rounded", xy(0.00005, 0.123456), "{\"xy\":[0.0001,0.1235]}");
+	ok &= check("xy too small", xy(0.00004, 0.00001), "{\"xy\":[0,0]}");
+	ok &= check("xy negative", xy(-0.5, -0.0125), "{\"xy\":[-0.5,-0.0125]}");
+	ok &= check("xy above one", xy(12.5, 1.00001), "{\"xy\":[12.5,1]}");
+	ok &= check("xy clamped", xy(1e12, -1e12), "{\"xy\":[1000000000,-1000000000]}");
+	ok &= check("xy not finite", xy(std::numeric_limits<double>::quiet_NaN(), -std::numeric_limits<double>::infinity()), "{\"xy\":[0,0]}");
+
+	return ok ? 0 : 1;
+}
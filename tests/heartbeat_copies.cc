@@ -0,0 +1,236 @@
+#include <shade/heartbeat.h>
+#include <shade/hue_data.h>
+#include <shade/listener.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+
+// A copy of hue::light_map allocates one node per light, so the nodes
+// allocated during a tick, past the ones the body decodes into, are
+// copies of the map. The allocations big enough to hold the /lights body
+// are copies of the body itself.
+static std::atomic<bool> counting{ false };
+static std::atomic<size_t> node_size{ 0 };
+static std::atomic<size_t> nodes{ 0 };
+static std::atomic<size_t> threshold{ 0 };
+static std::atomic<size_t> big_allocs{ 0 };
+
+void* operator new(size_t size)
+{
+	if (counting) {
+		if (size == node_size)
+			++nodes;
+		if (size >= threshold)
+			++big_allocs;
+	}
+	if (auto ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+#define PADDING (64 * 1024)
+#define LIGHTS 4
+
+namespace {
+	using namespace std::literals;
+
+	struct queue {
+		std::mutex lock;
+		std::deque<std::function<void()>> jobs;
+		std::function<void()> next_tick;
+
+		void push(std::function<void()>&& job)
+		{
+			std::lock_guard<std::mutex> guard{ lock };
+			jobs.push_back(std::move(job));
+		}
+
+		bool run_one()
+		{
+			std::function<void()> job;
+			{
+				std::lock_guard<std::mutex> guard{ lock };
+				if (jobs.empty())
+					return false;
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+			job();
+			return true;
+		}
+	};
+
+	struct timer : shade::io::timeout {};
+
+	struct strand : shade::io::strand {
+		queue* jobs;
+		explicit strand(queue* jobs) : jobs{ jobs } {}
+		void post(std::function<void()>&& cb) override { jobs->push(std::move(cb)); }
+		std::unique_ptr<shade::io::timeout> timeout(shade::io::milliseconds, std::function<void()>&& cb) override
+		{
+			jobs->next_tick = std::move(cb);
+			return std::make_unique<timer>();
+		}
+	};
+
+	struct network : shade::io::network {
+		queue jobs;
+		std::unique_ptr<shade::io::udp> udp_socket() override { return {}; }
+		std::unique_ptr<shade::io::tcp> tcp_socket() override { return {}; }
+		std::unique_ptr<shade::io::timeout> timeout(shade::io::milliseconds, std::function<void()>&&) override { return {}; }
+		std::unique_ptr<shade::io::strand> make_strand() override { return std::make_unique<strand>(&jobs); }
+	};
+
+	struct http : shade::io::http {
+		std::string lights;
+		std::string groups;
+
+		bool send(method, const tangle::uri& address, const std::string&, listener_ptr listener) override
+		{
+			auto path = address.path();
+			auto& body = path.length() > 7 && path.last(7) == "/lights" ? lights : groups;
+			listener->on_headers(200, "OK", {});
+			listener->on_data(body.data(), body.size());
+			listener->on_data(nullptr, 0);
+			return true;
+		}
+	};
+
+	struct events : shade::listener::manager, shade::listener::bridge {
+		std::atomic<size_t> updates{ 0 };
+		void onload(const shade::cache&) override {}
+		void onbridge(const std::shared_ptr<shade::model::bridge>&) override {}
+		shade::listener::bridge* bridge_listener(const std::shared_ptr<shade::model::bridge>&) override { return this; }
+
+		void update_start(const std::shared_ptr<shade::model::bridge>&) override {}
+		void source_added(const std::shared_ptr<shade::model::light_source>&) override {}
+		void source_removed(const std::shared_ptr<shade::model::light_source>&) override {}
+		void source_changed(const std::shared_ptr<shade::model::light_source>&) override {}
+		void update_end(const std::shared_ptr<shade::model::bridge>&) override { ++updates; }
+	};
+
+	struct storage : shade::listener::storage {
+		void mark_dirty() override {}
+	};
+
+	// The node of a map is allocated through the map's allocator, rebound
+	// to the node type; its size is the one to look for.
+	template <typename T>
+	struct node_probe {
+		using value_type = T;
+		node_probe() = default;
+		template <typename U> node_probe(const node_probe<U>&) {}
+
+		T* allocate(size_t count)
+		{
+			if (count == 1 && !std::is_pointer<T>::value)
+				node_size = sizeof(T);
+			return std::allocator<T>{}.allocate(count);
+		}
+
+		void deallocate(T* ptr, size_t count) { std::allocator<T>{}.deallocate(ptr, count); }
+
+		template <typename U> bool operator==(const node_probe<U>&) const { return true; }
+		template <typename U> bool operator!=(const node_probe<U>&) const { return false; }
+	};
+
+	void probe_node_size()
+	{
+		using value_type = shade::hue::light_map::value_type;
+		std::unordered_map<std::string, shade::hue::light, std::hash<std::string>, std::equal_to<std::string>, node_probe<value_type>> map;
+		map[""];
+	}
+
+	std::string lights_body(bool on)
+	{
+		std::string out = "{";
+		for (int i = 1; i <= LIGHTS; ++i) {
+			if (i > 1)
+				out += ",";
+			auto id = std::to_string(i);
+			out += "\"" + id + "\": {\"name\": \"Light " + id + "\", \"modelid\": \"LCT015\", \"uniqueid\": \"00:17:88:01:00:00:00:0" + id + "-0b\", "
+				"\"state\": {\"on\": " + (on ? "true" : "false") + ", \"bri\": 254, \"hue\": 8418, \"sat\": 140, \"ct\": 366, \"xy\": [0.4573, 0.41], \"colormode\": \"ct\"}}";
+		}
+		out.append(PADDING, ' ');
+		out += "}";
+		return out;
+	}
+
+	// Runs the strand until the change made by this tick reaches the
+	// listener; the decoding happens on the pool in between.
+	bool wait_for(network& net, events& listener, size_t updates)
+	{
+		auto until = std::chrono::steady_clock::now() + 5s;
+		while (listener.updates < updates) {
+			if (std::chrono::steady_clock::now() > until)
+				return false;
+			if (!net.jobs.run_one())
+				std::this_thread::sleep_for(1ms);
+		}
+		while (net.jobs.run_one()) {}
+		return true;
+	}
+}
+
+int main()
+{
+	network net;
+	http browser;
+	events listener;
+	storage dirty;
+	shade::workers pool{ 1 };
+	shade::cache view{ "test", &browser };
+
+	browser.groups = "{}";
+	view.bridge_located("001788FFFE000000", "http://127.0.0.1/", &dirty);
+	auto bridge = view.get("001788FFFE000000");
+
+	auto beat = std::make_shared<shade::heartbeat>(&view, &listener, &net, &pool, bridge);
+
+	probe_node_size();
+	if (!node_size) {
+		printf("could not find the size of a light map node\n");
+		return 1;
+	}
+
+	int result = 0;
+	for (size_t tick = 1; tick <= 2; ++tick) {
+		browser.lights = lights_body(tick % 2 != 0);
+		threshold = browser.lights.size();
+		nodes = 0;
+		big_allocs = 0;
+		counting = true;
+
+		if (tick == 1)
+			beat->start();
+		else
+			net.jobs.next_tick();
+
+		auto updated = wait_for(net, listener, tick);
+		counting = false;
+		if (!updated) {
+			printf("tick %zu: the update never reached the listener\n", tick);
+			return 1;
+		}
+
+		// the body is parsed as it arrives and decoded once, into a map
+		// of LIGHTS nodes; nothing holds the whole body
+		auto decoded = nodes.load();
+		auto buffers = big_allocs.load();
+		printf("tick %zu: %zu light map nodes for %d lights, %zu allocations the size of the body\n", tick, decoded, LIGHTS, buffers);
+		if (decoded != LIGHTS || buffers)
+			result = 1;
+	}
+
+	beat->stop();
+	while (net.jobs.run_one()) {}
+	return result;
+}
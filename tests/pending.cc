@@ -0,0 +1,137 @@
+#include <shade/model/bridge.h>
+#include <cstdio>
+
+namespace {
+	using namespace shade::model;
+
+	struct fixture {
+		std::shared_ptr<atom_table> atoms = std::make_shared<atom_table>();
+		std::shared_ptr<bridge> hub = std::make_shared<bridge>("001788FFFE000000", nullptr, atoms);
+
+		fixture()
+		{
+			bridge_diff diff;
+			for (auto id : { "1", "2" }) {
+				source_values values;
+				values.index = atoms->intern(id);
+				values.id = atoms->intern(std::string{ "00:17:88:01:00:00:00:0" } + id + "-0b");
+				values.name = std::string{ "Light " } + id;
+				values.bri = 10;
+				diff.added_lights.push_back(std::move(values));
+			}
+			change_set changes;
+			hub->apply(diff, changes);
+		}
+
+		std::shared_ptr<light> get(size_t index) const { return hub->lights()[index]; }
+
+		// What the heartbeat would report for the light
+		void report(size_t index, bool on, int bri)
+		{
+			bridge_diff diff;
+			auto values = get(index)->values();
+			values.on = on;
+			values.bri = bri;
+			diff.changed_lights.push_back(std::move(values));
+			hub->reconcile(diff);
+
+			change_set changes;
+			hub->apply(diff, changes);
+		}
+
+		void pend(std::uint64_t request, std::vector<std::pair<size_t, source_patch>> patches)
+		{
+			patch_list targets;
+			for (auto& patch : patches)
+				targets.push_back({ get(patch.first), patch.second });
+			change_set changes;
+			hub->pend(request, targets, changes);
+		}
+
+		void settle(std::uint64_t request, size_t index, std::uint32_t rejected)
+		{
+			change_set changes;
+			hub->settle(request, { get(index)->id() }, rejected, changes);
+		}
+	};
+
+	source_patch set_on(bool on)
+	{
+		source_patch out;
+		out.fields = field_on;
+		out.on = on;
+		return out;
+	}
+
+	source_patch set_bri(int bri)
+	{
+		source_patch out;
+		out.fields = field_bri;
+		out.bri = bri;
+		return out;
+	}
+
+	source_patch set_both(bool on, int bri)
+	{
+		auto out = set_on(on);
+		out.fields |= field_bri;
+		out.bri = bri;
+		return out;
+	}
+
+	bool check(const char* name, const fixture& model, size_t index, bool on, int bri, bool pending)
+	{
+		auto source = model.get(index);
+		auto ok = source->on() == on && source->bri() == bri && model.hub->pending() == pending;
+		printf("%s: on=%d bri=%d pending=%d%s\n", name, source->on(), source->bri(), model.hub->pending(), ok ? "" : " FAILED");
+		return ok;
+	}
+}
+
+int main()
+{
+	bool ok = true;
+
+	{
+		fixture model;
+
+		// the last patch for a light wins
+		model.pend(1, { { 0, set_both(true, 200) }, { 0, set_bri(100) } });
+		ok &= check("pended", model, 0, true, 100, true);
+
+		// a heartbeat from before the command does not undo it
+		model.report(0, false, 10);
+		ok &= check("stale heartbeat", model, 0, true, 100, true);
+
+		// only the rejected field goes back
+		model.settle(1, 0, field_bri);
+		ok &= check("bri rejected", model, 0, true, 10, false);
+	}
+
+	{
+		fixture model;
+		model.pend(1, { { 1, set_on(true) } });
+
+		// once the bridge reports what was asked, nothing is pending and
+		// a late answer has nothing to undo
+		model.report(1, true, 10);
+		ok &= check("confirmed", model, 1, true, 10, false);
+		model.settle(1, 1, field_on | field_bri | field_value);
+		ok &= check("late rejection", model, 1, true, 10, false);
+	}
+
+	{
+		fixture model;
+		model.pend(1, { { 0, set_bri(50) } });
+		model.pend(2, { { 0, set_on(true) } });
+
+		// the newer request settles the light, and rolls back to the
+		// values from before both
+		model.settle(1, 0, field_bri);
+		ok &= check("older answer", model, 0, true, 50, true);
+		model.settle(2, 0, field_on | field_bri);
+		ok &= check("both rejected", model, 0, false, 10, false);
+	}
+
+	return ok ? 0 : 1;
+}
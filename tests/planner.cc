@@ -0,0 +1,119 @@
+#include <shade/model/planner.h>
+#include <cstdio>
+#include <unordered_map>
+
+namespace {
+	using namespace shade::model;
+
+	struct fixture {
+		shade::vector_shared<light> lights;
+		shade::vector_shared<group> groups;
+
+		fixture()
+		{
+			for (int i = 0; i < 40; ++i)
+				lights.push_back(std::make_shared<light>());
+
+			// three groups of ten, one straddling two of them, one with
+			// every light and a small one inside the first
+			groups = { make(0, 10), make(10, 20), make(20, 30), make(25, 35), make(0, 40), make(5, 7) };
+		}
+
+		std::shared_ptr<group> make(size_t from, size_t to)
+		{
+			shade::vector_shared<light> members;
+			for (auto i = from; i < to; ++i)
+				members.push_back(lights[i]);
+			auto out = std::make_shared<group>();
+			out->lights(std::move(members));
+			return out;
+		}
+
+		std::vector<plan_target> targets(size_t from, size_t to, size_t state = 0)
+		{
+			std::vector<plan_target> out;
+			for (auto i = from; i < to; ++i)
+				out.push_back({ lights[i], state });
+			return out;
+		}
+	};
+
+	struct counts {
+		size_t groups = 0;
+		size_t lights = 0;
+	};
+
+	// Every light asked for gets the last state asked for it, and no
+	// command touches a light that was not asked for, or wants another
+	// state.
+	bool check(const char* name, const std::vector<plan_target>& targets, const std::vector<planned_command>& plan, counts expected)
+	{
+		std::unordered_map<const light*, size_t> wanted;
+		for (auto const& target : targets)
+			wanted[target.source.get()] = target.state;
+
+		bool ok = true;
+		counts actual;
+		std::unordered_map<const light*, size_t> sent;
+		auto visit = [&](const light* source, size_t state) {
+			auto it = wanted.find(source);
+			if (it == wanted.end() || it->second != state)
+				ok = false;
+			sent[source] = state;
+		};
+
+		for (auto const& command : plan) {
+			if (command.source->is_group()) {
+				++actual.groups;
+				for (auto const& member : std::static_pointer_cast<group>(command.source)->lights())
+					visit(member.get(), command.state);
+			} else {
+				++actual.lights;
+				visit(static_cast<const light*>(command.source.get()), command.state);
+			}
+		}
+
+		if (sent != wanted)
+			ok = false;
+		if (actual.groups != expected.groups || actual.lights != expected.lights)
+			ok = false;
+
+		printf("%s: %zu groups, %zu lights (expected %zu, %zu)%s\n", name, actual.groups, actual.lights, expected.groups, expected.lights, ok ? "" : " FAILED");
+		return ok;
+	}
+}
+
+int main()
+{
+	fixture model;
+	bool ok = true;
+
+	// one group a window: two groups and ten lights take two windows,
+	// where thirty lights would take three
+	auto targets = model.targets(0, 30);
+	ok &= check("30 lights", targets, plan_commands(targets, model.groups), { 2, 10 });
+	ok &= check("30 lights, 3 groups a window", targets, plan_commands(targets, model.groups, { 10, 3 }), { 3, 0 });
+
+	// the first group has a light wanting another state
+	targets = model.targets(0, 30);
+	targets[3].state = 1;
+	ok &= check("mixed states", targets, plan_commands(targets, model.groups, { 10, 3 }), { 3, 8 });
+
+	// a later state for the same light replaces the earlier one
+	targets = model.targets(0, 30);
+	targets.push_back({ model.lights[3], 1 });
+	ok &= check("last state wins", targets, plan_commands(targets, model.groups, { 10, 3 }), { 3, 8 });
+
+	targets = model.targets(0, 9);
+	ok &= check("no exact group", targets, plan_commands(targets, model.groups), { 1, 7 });
+
+	targets = model.targets(0, 40);
+	ok &= check("every light", targets, plan_commands(targets, model.groups), { 1, 0 });
+
+	targets = model.targets(0, 30, 0);
+	for (size_t i = 10; i < 30; ++i)
+		targets[i].state = 1;
+	ok &= check("two states", targets, plan_commands(targets, model.groups, { 10, 3 }), { 3, 0 });
+
+	return ok ? 0 : 1;
+}
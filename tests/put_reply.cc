@@ -0,0 +1,68 @@
+#include <shade/manager.h>
+#include <cstdio>
+
+namespace {
+	using namespace shade::model;
+
+	struct expected {
+		const char* name;
+		std::uint32_t asked;
+		int status;
+		const char* reply;
+		std::uint32_t applied;
+		std::uint32_t rejected;
+		bool ok;
+		bool throttled;
+	};
+
+	bool check(const expected& test)
+	{
+		auto result = shade::command_result(test.asked, test.status, json::from_string(test.reply));
+		auto ok = result.applied == test.applied
+			&& result.rejected == test.rejected
+			&& result.ok() == test.ok
+			&& result.throttled() == test.throttled;
+		printf("%s: applied=%02x rejected=%02x ok=%d throttled=%d%s\n", test.name, result.applied, result.rejected, result.ok(), result.throttled(), ok ? "" : " FAILED");
+		return ok;
+	}
+}
+
+int main()
+{
+	static const auto on = field_on;
+	static const auto bri = field_bri;
+	static const auto value = field_value;
+	static const auto all = field_on | field_bri | field_value;
+
+	static const expected tests[] = {
+		{ "all set", on | bri, 200,
+			R"([{"success":{"/lights/1/state/on":true}},{"success":{"/lights/1/state/bri":50}}])",
+			on | bri, 0, true, false },
+		{ "color set", value, 200,
+			R"([{"success":{"/lights/1/state/xy":[0.3,0.3]}}])",
+			value, 0, true, false },
+		{ "whole command", on | bri, 200,
+			R"([{"success":{"/groups/1/action":true}}])",
+			on | bri, 0, true, false },
+		{ "one field refused", on | bri, 200,
+			R"([{"success":{"/lights/1/state/on":false}},{"error":{"type":201,"address":"/lights/1/state/bri","description":"parameter, bri, is not modifiable. Device is set to off."}}])",
+			on, bri, false, false },
+		{ "one field left out", on | bri, 200,
+			R"([{"success":{"/lights/1/state/on":false}}])",
+			on, bri, false, false },
+		{ "empty reply", on, 200, "[]", 0, on, false, false },
+		{ "unknown field", on | bri, 200,
+			R"([{"success":{"/lights/1/state/on":true}},{"error":{"type":7,"address":"/lights/1/state/transitiontime","description":"invalid value"}}])",
+			0, all, false, false },
+		{ "busy", on, 200,
+			R"([{"error":{"type":901,"address":"/lights/1/state","description":"Internal error, 404"}}])",
+			0, all, false, true },
+		{ "not a reply", on, 200, R"({"on":true})", 0, all, false, false },
+		{ "http error", on, 503, "", 0, all, false, false },
+	};
+
+	bool ok = true;
+	for (auto const& test : tests)
+		ok &= check(test);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#include <tangle/msg/scan.h>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+
+#if defined(TANGLE_SCAN_AVX2)
+#define SCAN_PATH "avx2"
+#elif defined(TANGLE_SCAN_SSE2)
+#define SCAN_PATH "sse2"
+#else
+#define SCAN_PATH "memchr"
+#endif
+
+// Built once as is and once for AVX2; both have to agree with a plain
+// std::find, whatever the length of the block, its alignment and the
+// place of the byte looked for.
+namespace {
+	const char* headers[] = {
+		"HTTP/1.1 200 OK\r\n"
+		"Cache-Control: no-store, no-cache, must-revalidate, post-check=0, pre-check=0\r\n"
+		"Pragma: no-cache\r\n"
+		"Expires: Mon, 1 Aug 2011 09:00:00 GMT\r\n"
+		"Connection: close\r\n"
+		"Access-Control-Max-Age: 3600\r\n"
+		"Access-Control-Allow-Origin: *\r\n"
+		"Access-Control-Allow-Credentials: true\r\n"
+		"Access-Control-Allow-Methods: POST, GET, OPTIONS, PUT, DELETE, HEAD\r\n"
+		"Access-Control-Allow-Headers: Content-Type\r\n"
+		"Content-type: application/json\r\n"
+		"\r\n",
+
+		"HTTP/1.1 200 OK\r\n"
+		"HOST: 239.255.255.250:1900\r\n"
+		"EXT:\r\n"
+		"CACHE-CONTROL: max-age=100\r\n"
+		"LOCATION: http://192.168.1.20:80/description.xml\r\n"
+		"SERVER: Linux/3.14.0 UPnP/1.0 IpBridge/1.41.0\r\n"
+		"hue-bridgeid: 001788FFFE23BFC2\r\n"
+		"ST: upnp:rootdevice\r\n"
+		"USN: uuid:2f402f80-da50-11e1-9b23-001788255acc::upnp:rootdevice\r\n"
+		"\r\n",
+	};
+
+	int failures = 0;
+
+	void check(const std::string& block, char c)
+	{
+		auto begin = block.data();
+		auto end = begin + block.size();
+		for (auto cur = begin; cur <= end; ++cur) {
+			auto expected = std::find(cur, end, c);
+			auto actual = tangle::msg::scan::find(cur, end, c);
+			if (actual != expected) {
+				if (++failures < 10)
+					printf("'%c' from %zu of %zu: found at %zu, expected %zu\n", c, size_t(cur - begin), block.size(), size_t(actual - begin), size_t(expected - begin));
+			}
+		}
+	}
+}
+
+int main()
+{
+#if defined(TANGLE_SCAN_AVX2) && defined(__GNUC__)
+	if (!__builtin_cpu_supports("avx2")) {
+		printf("scan (" SCAN_PATH "): skipped, the CPU has no AVX2\n");
+		return 0;
+	}
+#endif
+#if defined(EXPECT_AVX2) && !defined(TANGLE_SCAN_AVX2)
+	printf("scan: built for AVX2, but the AVX2 path is not compiled\n");
+	return 1;
+#endif
+
+	for (auto block : headers) {
+		check(block, '\r');
+		check(block, ':');
+	}
+
+	std::mt19937 gen{ 2016 };
+	std::uniform_int_distribution<int> byte{ 'a', 'z' };
+	for (size_t length = 0; length < 200; ++length) {
+		std::string block(length, 'x');
+		for (auto& c : block)
+			c = (char)byte(gen);
+		check(block, '\r');
+		if (length) {
+			block[length / 2] = '\r';
+			block[length - 1] = '\r';
+			check(block, '\r');
+		}
+	}
+
+	printf("scan (" SCAN_PATH "): %s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,98 @@
+#include <tangle/msg/scan.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Splits header blocks into lines and names the way base_parser does,
+// once through tangle::msg::scan::find and once through the byte by
+// byte std::find it replaced.
+namespace {
+	std::vector<std::string> blocks()
+	{
+		std::vector<std::string> out;
+		out.push_back(
+			"HTTP/1.1 200 OK\r\n"
+			"Cache-Control: no-store, no-cache, must-revalidate, post-check=0, pre-check=0\r\n"
+			"Pragma: no-cache\r\n"
+			"Expires: Mon, 1 Aug 2011 09:00:00 GMT\r\n"
+			"Connection: close\r\n"
+			"Access-Control-Max-Age: 3600\r\n"
+			"Access-Control-Allow-Origin: *\r\n"
+			"Access-Control-Allow-Credentials: true\r\n"
+			"Access-Control-Allow-Methods: POST, GET, OPTIONS, PUT, DELETE, HEAD\r\n"
+			"Access-Control-Allow-Headers: Content-Type\r\n"
+			"Content-type: application/json\r\n"
+			"\r\n");
+
+		// three answers to each of the three M-SEARCHes, from a few bridges
+		for (int bridge = 0; bridge < 8; ++bridge) {
+			auto ip = std::to_string(20 + bridge);
+			for (auto st : { "upnp:rootdevice", "uuid:2f402f80-da50-11e1-9b23-001788255acc", "urn:schemas-upnp-org:device:basic:1" }) {
+				out.push_back(
+					"HTTP/1.1 200 OK\r\n"
+					"HOST: 239.255.255.250:1900\r\n"
+					"EXT:\r\n"
+					"CACHE-CONTROL: max-age=100\r\n"
+					"LOCATION: http://192.168.1." + ip + ":80/description.xml\r\n"
+					"SERVER: Linux/3.14.0 UPnP/1.0 IpBridge/1.41.0\r\n"
+					"hue-bridgeid: 001788FFFE23BF" + ip + "\r\n"
+					"ST: " + st + "\r\n"
+					"USN: uuid:2f402f80-da50-11e1-9b23-001788255acc::" + st + "\r\n"
+					"\r\n");
+			}
+		}
+		return out;
+	}
+
+	template <typename Find>
+	size_t split(const std::string& block, Find find)
+	{
+		size_t fields = 0;
+		auto cur = block.data();
+		auto end = cur + block.size();
+		while (cur != end) {
+			auto line = find(cur, end, '\r');
+			if (line == end)
+				break;
+			auto colon = find(cur, line, ':');
+			if (colon != line)
+				++fields;
+			cur = line + 1;
+			if (cur != end && *cur == '\n')
+				++cur;
+		}
+		return fields;
+	}
+
+	template <typename Find>
+	double measure(const std::vector<std::string>& input, size_t rounds, size_t& fields, Find find)
+	{
+		using clock = std::chrono::steady_clock;
+		fields = 0;
+		auto then = clock::now();
+		for (size_t round = 0; round < rounds; ++round) {
+			for (auto const& block : input)
+				fields += split(block, find);
+		}
+		auto elapsed = std::chrono::duration<double, std::nano>(clock::now() - then).count();
+		return elapsed / (rounds * input.size());
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	size_t rounds = argc > 1 ? std::stoul(argv[1]) : 20000;
+	auto input = blocks();
+
+	size_t plain_fields = 0;
+	size_t scan_fields = 0;
+	auto plain = measure(input, rounds, plain_fields, [](const char* cur, const char* end, char c) { return std::find(cur, end, c); });
+	auto scan = measure(input, rounds, scan_fields, [](const char* cur, const char* end, char c) { return tangle::msg::scan::find(cur, end, c); });
+
+	printf("%zu header blocks, %zu rounds\n", input.size(), rounds);
+	printf("std::find:   %8.1f ns per block\n", plain);
+	printf("scan::find:  %8.1f ns per block (%.2fx)\n", scan, plain / scan);
+	return plain_fields == scan_fields ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include <tangle/msg/http_parser.h>
+#include <tangle/msg/view_parser.h>
+#include <cstdio>
+#include <string>
+
+namespace {
+	using tangle::msg::parsing;
+
+	struct expected {
+		const char* line;
+		bool valid;
+		int status;
+		const char* reason;
+	};
+
+	bool status_of(tangle::msg::http_response_view& parser, const std::string& head, int& status, std::string& reason)
+	{
+		auto ret = parser.parse(head.data(), head.size());
+		if (std::get<parsing>(ret) == parsing::error)
+			return false;
+		status = parser.status();
+		reason = parser.reason().str();
+		return true;
+	}
+
+	bool status_of(tangle::msg::http_response& parser, const std::string& head, int& status, std::string& reason)
+	{
+		auto ret = parser.append(head.data(), head.size());
+		if (std::get<parsing>(ret) == parsing::error)
+			return false;
+		status = parser.status();
+		reason = parser.reason();
+		return true;
+	}
+
+	template <typename Parser>
+	bool check(const char* name, const expected& test)
+	{
+		Parser parser;
+		int status = 0;
+		std::string reason;
+		std::string head{ test.line };
+		head.append("\r\nContent-Length: 0\r\n\r\n");
+		auto valid = status_of(parser, head, status, reason);
+
+		auto ok = valid == test.valid && (!valid || (status == test.status && reason == test.reason));
+		printf("%s \"%s\": %s %d \"%s\"%s\n", name, test.line, valid ? "valid" : "invalid", status, reason.c_str(), ok ? "" : " FAILED");
+		return ok;
+	}
+}
+
+int main()
+{
+	static const expected tests[] = {
+		{ "HTTP/1.1 200 OK", true, 200, "OK" },
+		{ "HTTP/1.1 404 Not Found", true, 404, "Not Found" },
+		{ "HTTP/1.1 200 ", true, 200, "" },
+		{ "HTTP/1.1 200", true, 200, "" },
+		{ "HTTP/1.1 200OK", false, 0, "" },
+		{ "HTTP/1.1 OK", false, 0, "" },
+		{ "HTTP/1.1 99 Old", false, 0, "" },
+	};
+
+	bool ok = true;
+	for (auto const& test : tests) {
+		ok &= check<tangle::msg::http_response_view>("view", test);
+		ok &= check<tangle::msg::http_response>("copy", test);
+	}
+	return ok ? 0 : 1;
+}